@@ -0,0 +1,209 @@
+#include "color_index.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <execution>
+#include <numeric>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+
+namespace {
+
+    // Rows per parallel block, and between progress reports
+    constexpr int ROWS_PER_BLOCK = 64;
+
+    // Keys are opaque colors, so zero never occurs as one
+    constexpr uint32_t NO_COLOR = 0;
+
+    uint32_t opaque(QRgb pixel) {
+        return pixel | 0xff000000u;
+    }
+
+    // Open-addressing hash map from opaque colors to a 32-bit value, sized
+    // up front for a given number of colors. Linear probing; Fibonacci
+    // hashing spreads the near-identical keys of smooth gradients.
+    class color_table {
+
+        std::vector<uint32_t> keys_;
+        std::vector<uint32_t> values_;
+        size_t mask_;
+        int shift_;
+
+    public:
+
+        explicit color_table(size_t capacity) {
+            size_t slots = std::bit_ceil(std::max<size_t>(2 * capacity, 16));
+            keys_.assign(slots, NO_COLOR);
+            values_.resize(slots);
+            mask_ = slots - 1;
+            shift_ = 64 - std::countr_zero(slots);
+        }
+
+        // The slot holding key, or the empty slot where it would go
+        size_t find(uint32_t key) const {
+            size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> shift_);
+            while (keys_[slot] != NO_COLOR && keys_[slot] != key) {
+                slot = (slot + 1) & mask_;
+            }
+            return slot;
+        }
+
+        bool occupied(size_t slot) const {
+            return keys_[slot] != NO_COLOR;
+        }
+
+        uint32_t value(size_t slot) const {
+            return values_[slot];
+        }
+
+        void put(size_t slot, uint32_t key, uint32_t value) {
+            keys_[slot] = key;
+            values_[slot] = value;
+        }
+    };
+
+    struct found_color {
+        uint32_t color;
+        uint32_t first;
+    };
+}
+
+// -------------------------------------------------------------------------
+// ser::color_index Implementation
+// -------------------------------------------------------------------------
+
+ser::color_index::color_index(const QImage& img, size_t max_colors, const job_control& job) {
+    max_colors = std::min(max_colors, MAX_COLORS);
+    QImage rgb = img.convertToFormat(QImage::Format_RGB32);
+    const int width = rgb.width();
+    const int height = rgb.height();
+    if (width == 0 || height == 0) return;
+
+    std::vector<int> blocks((height + ROWS_PER_BLOCK - 1) / ROWS_PER_BLOCK);
+    std::iota(blocks.begin(), blocks.end(), 0);
+    auto first_pass = job.step(0.0, 0.5);
+    auto second_pass = job.step(0.5, 1.0);
+
+    // 1. Blocks of rows collect their distinct colors in parallel, in order
+    // of first appearance. Runs of one color, the bulk of flat art, cost a
+    // compare per pixel. A block that alone exceeds the limit stops them all.
+    std::vector<std::vector<found_color>> found(blocks.size());
+    std::atomic<bool> too_many = false;
+    std::atomic<int> blocks_done = 0;
+    std::for_each(std::execution::par, blocks.begin(), blocks.end(), [&](int block) {
+        if (too_many || job.stop_requested()) return;
+
+        color_table seen(max_colors + 1);
+        auto& colors = found[block];
+        uint32_t last = NO_COLOR;
+        int y1 = std::min((block + 1) * ROWS_PER_BLOCK, height);
+        for (int y = block * ROWS_PER_BLOCK; y < y1; ++y) {
+            const QRgb* line = reinterpret_cast<const QRgb*>(rgb.constScanLine(y));
+            for (int x = 0; x < width; ++x) {
+                uint32_t key = opaque(line[x]);
+                if (key == last) continue;
+                last = key;
+
+                size_t slot = seen.find(key);
+                if (seen.occupied(slot)) continue;
+                seen.put(slot, key, 0);
+                colors.push_back({ key, static_cast<uint32_t>(y) * width + x });
+                if (colors.size() > max_colors) {
+                    too_many = true;
+                    return;
+                }
+            }
+        }
+        first_pass.report(static_cast<double>(++blocks_done) / blocks.size());
+        });
+    if (too_many || job.stop_requested()) return;
+
+    // 2. Merge in block order, which keeps the colors in order of first
+    // appearance in the image
+    color_table table(max_colors);
+    for (const auto& colors : found) {
+        for (const auto& [key, first] : colors) {
+            size_t slot = table.find(key);
+            if (table.occupied(slot)) continue;
+            if (colors_.size() == max_colors) {
+                colors_.clear();
+                first_.clear();
+                return;
+            }
+            table.put(slot, key, static_cast<uint32_t>(colors_.size()));
+            colors_.push_back(key);
+            first_.push_back(first);
+        }
+    }
+    found.clear();
+
+    // 3. Index every pixel against the merged table, read-only by now
+    indices_.resize(static_cast<size_t>(width) * height);
+    blocks_done = 0;
+    std::for_each(std::execution::par, blocks.begin(), blocks.end(), [&](int block) {
+        if (job.stop_requested()) return;
+
+        uint32_t last = NO_COLOR;
+        uint16_t last_index = 0;
+        int y1 = std::min((block + 1) * ROWS_PER_BLOCK, height);
+        for (int y = block * ROWS_PER_BLOCK; y < y1; ++y) {
+            const QRgb* line = reinterpret_cast<const QRgb*>(rgb.constScanLine(y));
+            uint16_t* out = indices_.data() + static_cast<size_t>(y) * width;
+            for (int x = 0; x < width; ++x) {
+                uint32_t key = opaque(line[x]);
+                if (key != last) {
+                    last = key;
+                    last_index = static_cast<uint16_t>(table.value(table.find(key)));
+                }
+                out[x] = last_index;
+            }
+        }
+        second_pass.report(static_cast<double>(++blocks_done) / blocks.size());
+        });
+
+    if (job.stop_requested()) {
+        *this = color_index();
+        return;
+    }
+    wd_ = width;
+    hgt_ = height;
+}
+
+bool ser::color_index::empty() const {
+    return colors_.empty();
+}
+
+size_t ser::color_index::size() const {
+    return colors_.size();
+}
+
+int ser::color_index::width() const {
+    return wd_;
+}
+
+int ser::color_index::height() const {
+    return hgt_;
+}
+
+size_t ser::color_index::memory_usage() const {
+    return colors_.size() * sizeof(QRgb) + first_.size() * sizeof(uint32_t) +
+        indices_.size() * sizeof(uint16_t);
+}
+
+const std::vector<QRgb>& ser::color_index::colors() const {
+    return colors_;
+}
+
+int ser::color_index::first_x(size_t color) const {
+    return static_cast<int>(first_[color] % wd_);
+}
+
+int ser::color_index::first_y(size_t color) const {
+    return static_cast<int>(first_[color] / wd_);
+}
+
+const uint16_t* ser::color_index::row(int y) const {
+    return indices_.data() + static_cast<size_t>(y) * wd_;
+}
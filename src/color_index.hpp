@@ -0,0 +1,51 @@
+#pragma once
+
+#include "job_control.hpp"
+#include <cstdint>
+#include <vector>
+#include <QColor>
+#include <QImage>
+
+namespace ser {
+
+    // The distinct colors of an image and, per pixel, which of them it is.
+    // Posterized art and flat illustrations have a few thousand colors over
+    // tens of millions of pixels; work that depends only on the color can
+    // then be done once per entry of colors() and scattered through the
+    // index rows.
+    //
+    // Indexing gives up, leaving the index empty, once the image turns out
+    // to have more than max_colors colors. Callers then fall back to the
+    // per-pixel path.
+    class color_index {
+
+        std::vector<QRgb> colors_;     // opaque, in order of first appearance
+        std::vector<uint32_t> first_;  // y * width + x where each color first appears
+        std::vector<uint16_t> indices_;
+        int wd_ = 0;
+        int hgt_ = 0;
+
+    public:
+
+        static constexpr size_t MAX_COLORS = 65536;
+        static constexpr size_t DEFAULT_MAX_COLORS = 16384;
+
+        color_index() {}
+
+        // max_colors is capped at MAX_COLORS, the reach of the 16-bit
+        // indices. Also empty if cancelled.
+        color_index(const QImage& img, size_t max_colors = DEFAULT_MAX_COLORS, const job_control& job = {});
+
+        bool empty() const;
+        size_t size() const;
+        int width() const;
+        int height() const;
+        size_t memory_usage() const;
+
+        const std::vector<QRgb>& colors() const;
+        int first_x(size_t color) const;
+        int first_y(size_t color) const;
+        const uint16_t* row(int y) const;
+    };
+
+}
@@ -1,4 +1,8 @@
 #include "color_lut.hpp"
+#include "qp_solver.hpp"
+#include "lut_cache.hpp"
+#include "lut_kernels.hpp"
+#include "simd_support.hpp"
 #include "third-party/mixbox.h"
 
 // COIN-OR Clp Includes for Quadratic Programming
@@ -10,6 +14,10 @@
 #include <iostream>
 #include <numeric>
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <QImage>
 #include <execution> // Required for std::execution::par
 #include <qdebug.h>
 #include <qcolor.h>
@@ -22,10 +30,19 @@ namespace {
     // Grid size for the 3D LUT (33x33x33)
     constexpr int LUT_GRID_SIZE = 33;
 
+    // Coarsest level of a progressive bake. Doubling the cells per axis
+    // twice, 9 -> 17 -> 33, reaches LUT_GRID_SIZE.
+    constexpr int PREVIEW_GRID_SIZE = 9;
+
     // Regularization factor (lambda) for the Constrained Least Squares problem
     // Ensures stability ("Gray World") when exact matches are ambiguous
     constexpr double LAMBDA = 0.001;
 
+    // Number of adjacent green rows one sweep task walks through. Each task
+    // visits its nodes in serpentine order so that every node after the
+    // first is a lattice neighbour of the node solved just before it.
+    constexpr int SWEEP_BLOCK = 4;
+
     // Mixbox latent vector dimension (7D)
     constexpr int LATENT_DIM = MIXBOX_LATENT_SIZE;
 
@@ -37,6 +54,197 @@ namespace {
         return val;
     }
 
+    // Latent-space color of lattice node (r, g, b)
+    ser::latent_space_color lattice_target(int r, int g, int b, int grid) {
+        // Map grid index to RGB 0..255
+        uint8_t ur = static_cast<uint8_t>((r * 255) / (grid - 1));
+        uint8_t ug = static_cast<uint8_t>((g * 255) / (grid - 1));
+        uint8_t ub = static_cast<uint8_t>((b * 255) / (grid - 1));
+
+        mixbox_latent latent_arr;
+        mixbox_rgb_to_latent(ur, ug, ub, latent_arr);
+        ser::latent_space_color target_color;
+        std::copy(std::begin(latent_arr), std::end(latent_arr), target_color.begin());
+        return target_color;
+    }
+
+    // Solves the lattice nodes selected by mask (every node if mask is empty)
+    // into values. The solver precomputes V'V + lambda*I once. The lattice is
+    // swept in coherent blocks, each node warm-started from the solution of
+    // its predecessor. If once flags are given each node is solved under its
+    // flag, so a node also being solved on demand is never solved twice.
+    // Blocks not yet started when the job is cancelled are skipped.
+    ser::bake_stats sweep_lattice(const ser::qp_solver& solver, int grid, float* values,
+            const std::vector<uint8_t>& mask, std::once_flag* solved, const ser::job_control& job) {
+
+        const int n_colors = solver.size();
+        const int blocks_per_slab = (grid + SWEEP_BLOCK - 1) / SWEEP_BLOCK;
+        std::vector<int> blocks(grid * blocks_per_slab);
+        std::iota(blocks.begin(), blocks.end(), 0);
+
+        std::atomic<int> nodes = 0;
+        std::atomic<long long> iterations = 0;
+        std::atomic<int> blocks_done = 0;
+        std::for_each(std::execution::par, blocks.begin(), blocks.end(), [&](int block) {
+            if (job.stop_requested()) return;
+            int r = block / blocks_per_slab;
+            int g_begin = (block % blocks_per_slab) * SWEEP_BLOCK;
+            int g_end = std::min(g_begin + SWEEP_BLOCK, grid);
+
+            int block_nodes = 0;
+            long long block_iterations = 0;
+            ser::coefficients k(n_colors);
+            ser::coefficients prev;
+            for (int g = g_begin; g < g_end; ++g) {
+                bool forward = ((g - g_begin) % 2 == 0);
+                for (int i = 0; i < grid; ++i) {
+                    int b = forward ? i : grid - 1 - i;
+                    size_t node = node_index(r, g, b, grid);
+                    if (!mask.empty() && !mask[node]) continue;
+
+                    float* out = values + node * n_colors;
+                    auto solve_node = [&]() {
+                        block_iterations += solver.solve(lattice_target(r, g, b, grid), k, prev);
+                        std::copy(k.begin(), k.end(), out);
+                        ++block_nodes;
+                        };
+                    if (solved) {
+                        std::call_once(solved[node], solve_node);
+                    } else {
+                        solve_node();
+                    }
+                    prev.assign(out, out + n_colors);
+                }
+            }
+            nodes += block_nodes;
+            iterations += block_iterations;
+            job.report(static_cast<double>(++blocks_done) / blocks.size());
+            });
+
+        return { nodes.load(), iterations.load(), static_cast<int>(solver.cached_factorizations()) };
+    }
+
+    // How a palette differs from the current one, with the index of the
+    // inserted, removed or replaced entry
+    enum class palette_edit {
+        none,
+        replace,
+        insert,
+        remove,
+        other
+    };
+
+    std::pair<palette_edit, size_t> diff_palettes(const std::vector<QColor>& current,
+            const std::vector<QColor>& palette) {
+        size_t n_old = current.size();
+        size_t n_new = palette.size();
+
+        // Length of the common prefix and suffix of the two palettes
+        size_t prefix = 0;
+        while (prefix < n_old && prefix < n_new && current[prefix] == palette[prefix]) ++prefix;
+        size_t suffix = 0;
+        while (suffix < n_old - prefix && suffix < n_new - prefix &&
+            current[n_old - 1 - suffix] == palette[n_new - 1 - suffix]) ++suffix;
+
+        if (n_new == n_old && prefix == n_old) return { palette_edit::none, 0 };
+        if (n_new == n_old && prefix + suffix == n_old - 1) return { palette_edit::replace, prefix };
+        if (n_new == n_old + 1 && prefix + suffix == n_old) return { palette_edit::insert, prefix };
+        if (n_new + 1 == n_old && prefix + suffix == n_new) return { palette_edit::remove, prefix };
+        return { palette_edit::other, 0 };
+    }
+
+    // Only full-resolution LUTs are cached; preview levels are cheap to bake
+    ser::lut_key cache_key(const std::vector<QColor>& palette, ser::qp_backend backend) {
+        return { palette, LUT_GRID_SIZE, LAMBDA, (ser::SOLVER_VERSION << 8) | static_cast<uint32_t>(backend) };
+    }
+
+    // Lower corner of the lattice cell a color falls into, matching the
+    // cell locate picks
+    size_t cell_index(QRgb rgb, int grid) {
+        const int cells_per_axis = grid - 1;
+        int r0 = clamp(static_cast<int>(qRed(rgb) * (grid - 1) / 255.0f), 0, grid - 2);
+        int g0 = clamp(static_cast<int>(qGreen(rgb) * (grid - 1) / 255.0f), 0, grid - 2);
+        int b0 = clamp(static_cast<int>(qBlue(rgb) * (grid - 1) / 255.0f), 0, grid - 2);
+        return (static_cast<size_t>(r0) * cells_per_axis + g0) * cells_per_axis + b0;
+    }
+
+    // Sample the coefficient vector using Trilinear Interpolation. Each
+    // interpolated coefficient is handed to store(i, value).
+    template <typename Store>
+    void interpolate_trilinear(const float* lut, int n, int grid, QRgb rgb, Store&& store) {
+        if (n == 0) return;
+
+        auto [node, tr, tg, tb] = locate(rgb, grid);
+
+        // Corners along blue are adjacent, so each (r, g) pair is one run of 2n floats
+        const size_t r_stride = static_cast<size_t>(grid) * grid * n;
+        const size_t g_stride = static_cast<size_t>(grid) * n;
+        const float* c00x = lut + node * n;
+        const float* c10x = c00x + r_stride;
+        const float* c01x = c00x + g_stride;
+        const float* c11x = c10x + g_stride;
+
+        for (int i = 0; i < n; ++i) {
+            float c00 = c00x[i] * (1 - tr) + c10x[i] * tr;
+            float c01 = c00x[n + i] * (1 - tr) + c10x[n + i] * tr;
+            float c10 = c01x[i] * (1 - tr) + c11x[i] * tr;
+            float c11 = c01x[n + i] * (1 - tr) + c11x[n + i] * tr;
+
+            float c0 = c00 * (1 - tg) + c10 * tg;
+            float c1 = c01 * (1 - tg) + c11 * tg;
+
+            store(i, c0 * (1 - tb) + c1 * tb);
+        }
+    }
+
+    // Sample the coefficient vector using Tetrahedral Interpolation, which
+    // reads 4 of the 8 cell corners
+    template <typename Store>
+    void interpolate_tetrahedral(const float* lut, int n, int grid, QRgb rgb, Store&& store) {
+        if (n == 0) return;
+
+        auto [node, tr, tg, tb] = locate(rgb, grid);
+
+        const size_t r_stride = static_cast<size_t>(grid) * grid * n;
+        const size_t g_stride = static_cast<size_t>(grid) * n;
+        tetrahedron t = select_tetrahedron(tr, tg, tb, r_stride, g_stride, n);
+        const float* c0 = lut + node * n;
+        const float* c1 = c0 + t.first;
+        const float* c2 = c0 + t.second;
+        const float* c3 = c0 + r_stride + g_stride + n;
+
+        for (int i = 0; i < n; ++i) {
+            store(i, t.w[0] * c0[i] + t.w[1] * c1[i] + t.w[2] * c2[i] + t.w[3] * c3[i]);
+        }
+    }
+
+    template <typename Store>
+    void interpolate(ser::interpolation mode, const float* lut, int n, int grid, QRgb rgb, Store&& store) {
+        if (mode == ser::interpolation::tetrahedral) {
+            interpolate_tetrahedral(lut, n, grid, rgb, store);
+        } else {
+            interpolate_trilinear(lut, n, grid, rgb, store);
+        }
+    }
+
+    template <typename T>
+    void interpolate_row(ser::interpolation mode, const float* lut, int n, int grid,
+            const QRgb* pixels, int count, T* const* out_rows) {
+        if (n == 0) return;
+
+        int x = 0;
+#if SERIGRAPH_BUILD_AVX2
+        if (ser::cpu_has_avx2()) {
+            x = ser::kernels::interpolate_row_avx2(mode, lut, n, grid, pixels, count, out_rows);
+        }
+#endif
+        for (; x < count; ++x) {
+            interpolate(mode, lut, n, grid, pixels[x], [&](int i, float v) {
+                out_rows[i][x] = static_cast<T>(v);
+                });
+        }
+    }
+
 } // namespace
 
 
@@ -44,28 +252,421 @@ namespace {
 // ser::color_lut Implementation
 // -------------------------------------------------------------------------
 
-ser::color_lut::color_lut(const std::vector<QColor>& palette) {
-    // Initialize the LUT structure: vector of vector of vector
-    impl_.resize(LUT_GRID_SIZE);
-    for (int i = 0; i < LUT_GRID_SIZE; ++i) {
-        impl_[i].resize(LUT_GRID_SIZE);
-        for (int j = 0; j < LUT_GRID_SIZE; ++j) {
-            impl_[i][j].resize(LUT_GRID_SIZE);
-        }
-    }
+// Lattice of a lazily baked LUT. It is shared between copies of the LUT so
+// that nodes solved on demand through any copy are visible to all of them.
+struct ser::color_lut::lazy_state {
+    std::unique_ptr<const qp_solver> solver;
+    aligned_vector<float> values;
+    std::unique_ptr<std::once_flag[]> node_solved;
+    std::unique_ptr<std::atomic<bool>[]> cell_ready;
+};
+
+ser::color_lut::color_lut(const std::vector<QColor>& palette, const QImage& footprint, qp_backend backend) :
+        backend_(backend) {
+    reset_palette(palette, footprint);
+}
 
+ser::color_lut::color_lut(const std::vector<QColor>& palette, qp_backend backend) :
+        backend_(backend) {
     // Immediately "bake" the palette into the LUT
     reset_palette(palette);
 }
 
-void ser::color_lut::reset_palette(const std::vector<QColor>& palette) {
+void ser::color_lut::reset_palette(const std::vector<QColor>& palette, const job_control& job) {
     // 1. Convert Source Palette to Latent Space
+    source_palette_ = palette;
+    palette_ = ser::to_latent_space(palette);
+    grid_size_ = LUT_GRID_SIZE;
+    stats_ = {};
+    mapped_.reset();
+    lazy_.reset();
+    impl_.clear();
+    int n_colors = static_cast<int>(palette_.size());
+    if (n_colors == 0) return;
+
+    // 2. Reuse a previously baked LUT from the on-disk cache if there is one
+    lut_key key = cache_key(source_palette_, backend_);
+    if ((mapped_ = lut_file::open(lut_cache_path(key), key))) {
+        return;
+    }
+
+    // 3. Bake, then store the result for next time. A cancelled bake is
+    // incomplete, so it is neither cached nor kept.
+    impl_.assign(static_cast<size_t>(n_colors) * grid_size_ * grid_size_ * grid_size_, 0.0f);
+    bool baked = (backend_ == qp_backend::active_set) ? bake_active_set(job) : bake_clp(job);
+    if (!baked) {
+        reset_palette({});
+        return;
+    }
+    store_in_cache();
+}
+
+void ser::color_lut::reset_palette(const std::vector<QColor>& palette, const QImage& footprint) {
+    source_palette_ = palette;
     palette_ = ser::to_latent_space(palette);
+    grid_size_ = LUT_GRID_SIZE;
+    stats_ = {};
+    mapped_.reset();
+    lazy_.reset();
+    impl_.clear();
     int n_colors = static_cast<int>(palette_.size());
     if (n_colors == 0) return;
 
-    // 2. Pre-calculate the Hessian (Q Matrix)
+    // A complete LUT from the cache beats a partial one. The Clp path has no
+    // shared solver to finish nodes on demand, so it always bakes eagerly.
+    lut_key key = cache_key(source_palette_, backend_);
+    if ((mapped_ = lut_file::open(lut_cache_path(key), key))) {
+        return;
+    }
+    if (backend_ != qp_backend::active_set) {
+        reset_palette(palette);
+        return;
+    }
+
+    // 1. Mark the cells the image's pixels fall into
+    const int cells_per_axis = grid_size_ - 1;
+    std::vector<uint8_t> cell_used(static_cast<size_t>(cells_per_axis) * cells_per_axis * cells_per_axis, 0);
+    QImage img = footprint.convertToFormat(QImage::Format_RGB32);
+    std::vector<int> rows(img.height());
+    std::iota(rows.begin(), rows.end(), 0);
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(img.constScanLine(y));
+        for (int x = 0; x < img.width(); ++x) {
+            size_t cell = cell_index(line[x], grid_size_);
+            std::atomic_ref<uint8_t>(cell_used[cell]).store(1, std::memory_order_relaxed);
+        }
+        });
+
+    // 2. Their corners are the nodes to solve up front
+    const size_t total_nodes = static_cast<size_t>(grid_size_) * grid_size_ * grid_size_;
+    std::vector<uint8_t> node_used(total_nodes, 0);
+    for (int r = 0; r < cells_per_axis; ++r) {
+        for (int g = 0; g < cells_per_axis; ++g) {
+            for (int b = 0; b < cells_per_axis; ++b) {
+                if (!cell_used[(static_cast<size_t>(r) * cells_per_axis + g) * cells_per_axis + b]) continue;
+                for (int corner = 0; corner < 8; ++corner) {
+                    node_used[node_index(r + (corner >> 2), g + ((corner >> 1) & 1), b + (corner & 1), grid_size_)] = 1;
+                }
+            }
+        }
+    }
+
+    // 3. Solve them; everything else is solved on demand by look_up
+    auto lazy = std::make_shared<lazy_state>();
+    lazy->solver = std::make_unique<const qp_solver>(palette_, LAMBDA);
+    lazy->values.assign(static_cast<size_t>(n_colors) * total_nodes, 0.0f);
+    lazy->node_solved = std::make_unique<std::once_flag[]>(total_nodes);
+    lazy->cell_ready = std::make_unique<std::atomic<bool>[]>(cell_used.size());
+    stats_ = sweep_lattice(*lazy->solver, grid_size_, lazy->values.data(), node_used, lazy->node_solved.get(), {});
+    for (size_t cell = 0; cell < cell_used.size(); ++cell) {
+        lazy->cell_ready[cell].store(cell_used[cell] != 0, std::memory_order_relaxed);
+    }
+    lazy_ = std::move(lazy);
+}
+
+void ser::color_lut::ensure_cell(QRgb rgb) const {
+    size_t cell = cell_index(rgb, grid_size_);
+    if (lazy_->cell_ready[cell].load(std::memory_order_acquire)) return;
+
+    const int cells_per_axis = grid_size_ - 1;
+    int r0 = static_cast<int>(cell / (cells_per_axis * cells_per_axis));
+    int g0 = static_cast<int>((cell / cells_per_axis) % cells_per_axis);
+    int b0 = static_cast<int>(cell % cells_per_axis);
+    for (int corner = 0; corner < 8; ++corner) {
+        ensure_node(r0 + (corner >> 2), g0 + ((corner >> 1) & 1), b0 + (corner & 1));
+    }
+    lazy_->cell_ready[cell].store(true, std::memory_order_release);
+}
+
+void ser::color_lut::ensure_node(int r, int g, int b) const {
+    const int n_colors = lazy_->solver->size();
+    size_t node = node_index(r, g, b, grid_size_);
+    std::call_once(lazy_->node_solved[node], [&]() {
+        coefficients k(n_colors);
+        lazy_->solver->solve(lattice_target(r, g, b, grid_size_), k);
+        std::copy(k.begin(), k.end(), lazy_->values.begin() + node * n_colors);
+        });
+}
+
+bool ser::color_lut::is_lazy() const {
+    return lazy_ != nullptr;
+}
+
+void ser::color_lut::solve_all() const {
+    if (!lazy_) return;
+
+    // The cell holding a node's own color always has that node as a corner
+    for (int r = 0; r < grid_size_; ++r) {
+        for (int g = 0; g < grid_size_; ++g) {
+            for (int b = 0; b < grid_size_; ++b) {
+                ensure_cell(qRgb((r * 255) / (grid_size_ - 1), (g * 255) / (grid_size_ - 1), (b * 255) / (grid_size_ - 1)));
+            }
+        }
+    }
+}
+
+int ser::color_lut::reset_preview(const std::vector<QColor>& palette, const job_control& job) {
+    reset_palette({});
+    source_palette_ = palette;
+    palette_ = ser::to_latent_space(palette);
+    int n_colors = static_cast<int>(palette_.size());
+    if (n_colors == 0) return 0;
+
+    // A full LUT from the cache needs no preview
+    lut_key key = cache_key(source_palette_, backend_);
+    if ((mapped_ = lut_file::open(lut_cache_path(key), key))) {
+        return 0;
+    }
+
+    grid_size_ = PREVIEW_GRID_SIZE;
+    impl_.assign(static_cast<size_t>(n_colors) * grid_size_ * grid_size_ * grid_size_, 0.0f);
+    bool baked = (backend_ == qp_backend::active_set) ? bake_active_set(job) : bake_clp(job);
+    if (!baked) {
+        reset_palette({});
+        return -1;
+    }
+    return stats_.nodes;
+}
+
+int ser::color_lut::refine(const job_control& job) {
+    if (is_refined() || palette_.empty()) return 0;
+
+    // The Clp path has no warm starts to gain from the coarse level
+    if (backend_ != qp_backend::active_set) {
+        reset_palette(source_palette_, job);
+        return source_palette_.empty() ? -1 : stats_.nodes;
+    }
+
+    // 1. Node (r, g, b) of the coarse lattice is node (2r, 2g, 2b) of the
+    // fine one and targets exactly the same color, so it is copied as is
+    const int n_colors = static_cast<int>(palette_.size());
+    const int coarse = grid_size_;
+    const int fine = 2 * coarse - 1;
+    aligned_vector<float> refined(static_cast<size_t>(n_colors) * fine * fine * fine);
+    for (int r = 0; r < coarse; ++r) {
+        for (int g = 0; g < coarse; ++g) {
+            for (int b = 0; b < coarse; ++b) {
+                std::copy_n(impl_.data() + node_index(r, g, b, coarse) * n_colors, n_colors,
+                    refined.data() + node_index(2 * r, 2 * g, 2 * b, fine) * n_colors);
+            }
+        }
+    }
+
+    // 2. Every other node lies between coarse nodes and is warm-started
+    // from the coarse node at its lower corner
+    const qp_solver solver(palette_, LAMBDA);
+    std::vector<int> slabs(fine);
+    std::iota(slabs.begin(), slabs.end(), 0);
+
+    std::atomic<int> solved = 0;
+    std::atomic<long long> iterations = 0;
+    std::atomic<int> slabs_done = 0;
+    std::for_each(std::execution::par, slabs.begin(), slabs.end(), [&](int r) {
+        if (job.stop_requested()) return;
+        int slab_solved = 0;
+        long long slab_iterations = 0;
+        coefficients warm;
+        coefficients k(n_colors);
+        for (int g = 0; g < fine; ++g) {
+            for (int b = 0; b < fine; ++b) {
+                if (r % 2 == 0 && g % 2 == 0 && b % 2 == 0) continue;
+
+                const float* start = refined.data() + node_index(r & ~1, g & ~1, b & ~1, fine) * n_colors;
+                warm.assign(start, start + n_colors);
+                slab_iterations += solver.solve(lattice_target(r, g, b, fine), k, warm);
+                std::copy(k.begin(), k.end(), refined.begin() + node_index(r, g, b, fine) * n_colors);
+                ++slab_solved;
+            }
+        }
+        solved += slab_solved;
+        iterations += slab_iterations;
+        job.report(static_cast<double>(++slabs_done) / slabs.size());
+        });
+
+    if (job.stop_requested()) {
+        reset_palette({});
+        return -1;
+    }
+
+    grid_size_ = fine;
+    impl_ = std::move(refined);
+    stats_ = { solved.load(), iterations.load(), static_cast<int>(solver.cached_factorizations()) };
+    if (is_refined()) {
+        store_in_cache();
+    }
+    return stats_.nodes;
+}
+
+bool ser::color_lut::is_refined() const {
+    return grid_size_ == LUT_GRID_SIZE;
+}
+
+int ser::color_lut::insert_ink(int index, const QColor& color, const job_control& job) {
+    auto palette = source_palette_;
+    index = std::clamp(index, 0, static_cast<int>(palette.size()));
+    palette.insert(palette.begin() + index, color);
+
+    // The old solution with the new ink at zero is feasible, and optimal
+    // wherever the new ink's reduced gradient is non-negative
+    return rebake_delta(palette, [index](std::span<const float> old_k, coefficients& k) {
+        k.assign(old_k.begin(), old_k.end());
+        k.insert(k.begin() + index, 0.0);
+        }, job);
+}
+
+int ser::color_lut::remove_ink(int index, const job_control& job) {
+    if (index < 0 || index >= static_cast<int>(source_palette_.size())) return 0;
+    auto palette = source_palette_;
+    palette.erase(palette.begin() + index);
+
+    // Nodes that did not use the removed ink keep their solution; the others
+    // start from the remaining inks rescaled back onto the simplex
+    return rebake_delta(palette, [index](std::span<const float> old_k, coefficients& k) {
+        k.assign(old_k.begin(), old_k.end());
+        k.erase(k.begin() + index);
+        double sum = std::accumulate(k.begin(), k.end(), 0.0);
+        if (sum > 0.0) {
+            for (auto& v : k) v /= sum;
+        } else {
+            k.clear();
+        }
+        }, job);
+}
+
+int ser::color_lut::replace_ink(int index, const QColor& color, const job_control& job) {
+    if (index < 0 || index >= static_cast<int>(source_palette_.size())) return 0;
+    auto palette = source_palette_;
+    palette[index] = color;
+
+    return rebake_delta(palette, [](std::span<const float> old_k, coefficients& k) {
+        k.assign(old_k.begin(), old_k.end());
+        }, job);
+}
+
+int ser::color_lut::update_palette(const std::vector<QColor>& palette, const job_control& job) {
+    if (can_update_incrementally(palette)) {
+        auto [edit, index] = diff_palettes(source_palette_, palette);
+        switch (edit) {
+        case palette_edit::none:
+            return 0;
+        case palette_edit::replace:
+            return replace_ink(static_cast<int>(index), palette[index], job);
+        case palette_edit::insert:
+            return insert_ink(static_cast<int>(index), palette[index], job);
+        case palette_edit::remove:
+            return remove_ink(static_cast<int>(index), job);
+        default:
+            break;
+        }
+    }
+
+    reset_palette(palette, job);
+    return (source_palette_.empty() && !palette.empty()) ? -1 : stats_.nodes;
+}
+
+bool ser::color_lut::can_update_incrementally(const std::vector<QColor>& palette) const {
+    if (source_palette_.empty() || backend_ != qp_backend::active_set || grid_size_ != LUT_GRID_SIZE) {
+        return false;
+    }
+    auto edit = diff_palettes(source_palette_, palette).first;
+    return edit == palette_edit::none || (edit != palette_edit::other && !lazy_);
+}
+
+int ser::color_lut::rebake_delta(const std::vector<QColor>& palette,
+        const std::function<void(std::span<const float>, coefficients&)>& warm_start,
+        const job_control& job) {
+
+    if (source_palette_.empty() || palette.empty() || lazy_ || backend_ != qp_backend::active_set ||
+            grid_size_ != LUT_GRID_SIZE) {
+        reset_palette(palette, job);
+        return (source_palette_.empty() && !palette.empty()) ? -1 : stats_.nodes;
+    }
+
+    lut_key key = cache_key(palette, backend_);
+    if (auto cached = lut_file::open(lut_cache_path(key), key)) {
+        source_palette_ = palette;
+        palette_ = ser::to_latent_space(palette);
+        impl_.clear();
+        mapped_ = std::move(cached);
+        stats_ = {};
+        return 0;
+    }
+
+    const float* old_data = data();
+    const size_t old_n = palette_.size();
+
+    auto new_palette = ser::to_latent_space(palette);
+    const int n_colors = static_cast<int>(new_palette.size());
+    const qp_solver solver(new_palette, LAMBDA);
+
+    const int total_nodes = grid_size_ * grid_size_ * grid_size_;
+    aligned_vector<float> updated(static_cast<size_t>(n_colors) * total_nodes);
+    std::vector<int> slabs(grid_size_);
+    std::iota(slabs.begin(), slabs.end(), 0);
+
+    std::atomic<int> touched = 0;
+    std::atomic<long long> iterations = 0;
+    std::atomic<int> slabs_done = 0;
+    std::for_each(std::execution::par, slabs.begin(), slabs.end(), [&](int r) {
+        if (job.stop_requested()) return;
+        int slab_touched = 0;
+        long long slab_iterations = 0;
+        coefficients warm;
+        coefficients k(n_colors);
+        for (int g = 0; g < grid_size_; ++g) {
+            for (int b = 0; b < grid_size_; ++b) {
+                size_t node = node_index(r, g, b, grid_size_);
+                warm_start({ old_data + node * old_n, old_n }, warm);
+
+                auto target = lattice_target(r, g, b, grid_size_);
+                if (solver.is_optimal(target, warm)) {
+                    std::copy(warm.begin(), warm.end(), updated.begin() + node * n_colors);
+                    continue;
+                }
+
+                slab_iterations += solver.solve(target, k, warm);
+                std::copy(k.begin(), k.end(), updated.begin() + node * n_colors);
+                ++slab_touched;
+            }
+        }
+        touched += slab_touched;
+        iterations += slab_iterations;
+        job.report(static_cast<double>(++slabs_done) / slabs.size());
+        });
+
+    if (job.stop_requested()) {
+        reset_palette({});
+        return -1;
+    }
+
+    source_palette_ = palette;
+    palette_ = std::move(new_palette);
+    impl_ = std::move(updated);
+    mapped_.reset();
+    stats_ = { touched.load(), iterations.load(), static_cast<int>(solver.cached_factorizations()) };
+    store_in_cache();
+
+    return stats_.nodes;
+}
+
+void ser::color_lut::store_in_cache() const {
+    lut_key key = cache_key(source_palette_, backend_);
+    lut_file::write(lut_cache_path(key), key, impl_);
+}
+
+bool ser::color_lut::bake_active_set(const job_control& job) {
+    const qp_solver solver(palette_, LAMBDA);
+    stats_ = sweep_lattice(solver, grid_size_, impl_.data(), {}, nullptr, job);
+    return !job.stop_requested();
+}
+
+bool ser::color_lut::bake_clp(const job_control& job) {
+    int n_colors = static_cast<int>(palette_.size());
+
+    // 1. Pre-calculate the Hessian (Q Matrix)
     // Q = 2 * (V'V + lambda*I). Clp requires Lower Triangular matrix for Barrier.
+    // Products are taken in double, as qp_solver forms them; rounding them
+    // to float moves the solutions by up to a few 1e-6.
     std::vector<CoinBigIndex> col_starts;
     std::vector<int> row_indices;
     std::vector<double> elements;
@@ -83,7 +684,7 @@ void ser::color_lut::reset_palette(const std::vector<QColor>& palette) {
         for (int i = j; i < n_colors; ++i) {
             double dot = 0.0;
             for (int d = 0; d < LATENT_DIM; ++d) {
-                dot += palette_[i][d] * palette_[j][d];
+                dot += static_cast<double>(palette_[i][d]) * palette_[j][d];
             }
             if (i == j) dot += LAMBDA;
 
@@ -103,31 +704,32 @@ void ser::color_lut::reset_palette(const std::vector<QColor>& palette) {
         elements.data(), row_indices.data(),
         col_starts.data(), col_lengths.data());
 
-    // 3. Prepare Parallel Loop (using flat index range)
-    const int total_cells = LUT_GRID_SIZE * LUT_GRID_SIZE * LUT_GRID_SIZE;
+    // 2. Prepare Parallel Loop (using flat index range)
+    const int total_cells = grid_size_ * grid_size_ * grid_size_;
     std::vector<int> indices(total_cells);
     std::iota(indices.begin(), indices.end(), 0);
 
-    // 4. Parallel Solve using C++17 Execution Policy
+    // 3. Parallel Solve using C++17 Execution Policy
+    std::atomic<int> solved = 0;
     std::for_each(std::execution::par, indices.begin(), indices.end(), [&](int idx) {
-        // Map 1D index back to 3D grid
-        int r = idx / (LUT_GRID_SIZE * LUT_GRID_SIZE);
-        int g = (idx / LUT_GRID_SIZE) % LUT_GRID_SIZE;
-        int b = idx % LUT_GRID_SIZE;
-
-        // Map grid index to RGB 0..255
-        uint8_t ur = static_cast<uint8_t>((r * 255) / (LUT_GRID_SIZE - 1));
-        uint8_t ug = static_cast<uint8_t>((g * 255) / (LUT_GRID_SIZE - 1));
-        uint8_t ub = static_cast<uint8_t>((b * 255) / (LUT_GRID_SIZE - 1));
+        if (job.stop_requested()) return;
 
-        mixbox_latent latent_arr;
-        mixbox_rgb_to_latent(ur, ug, ub, latent_arr);
-        ser::latent_space_color target_color;
-        std::copy(std::begin(latent_arr), std::end(latent_arr), target_color.begin());
+        // Map 1D index back to 3D grid
+        int r = idx / (grid_size_ * grid_size_);
+        int g = (idx / grid_size_) % grid_size_;
+        int b = idx % grid_size_;
 
         // Solve for this node (each thread creates its own Clp instance)
-        impl_[r][g][b] = solve_with_precomputed_q(palette_, target_color, shared_Q);
+        auto k = solve_with_precomputed_q(palette_, lattice_target(r, g, b, grid_size_), shared_Q);
+        std::copy(k.begin(), k.end(), node_data(r, g, b).begin());
+
+        // One report per slab of nodes
+        if (++solved % (grid_size_ * grid_size_) == 0) {
+            job.report(static_cast<double>(solved) / total_cells);
+        }
         });
+
+    return !job.stop_requested();
 }
 
 ser::coefficients ser::color_lut::solve_with_precomputed_q(
@@ -142,11 +744,11 @@ ser::coefficients ser::color_lut::solve_with_precomputed_q(
     model.setLogLevel(0);
 
     // Add variables (k_i) with constraints 0.0 <= k_i <= 1.0
-    // Objective linear term: c = -2 * V'T
+    // Objective linear term: c = -2 * V'T, in double like Q
     for (int i = 0; i < n_colors; ++i) {
         double dot_vt = 0.0;
         for (int d = 0; d < LATENT_DIM; ++d) {
-            dot_vt += palette[i][d] * target[d];
+            dot_vt += static_cast<double>(palette[i][d]) * target[d];
         }
         model.addColumn(0, nullptr, nullptr, 0.0, 1.0, -2.0 * dot_vt);
     }
@@ -176,54 +778,95 @@ ser::coefficients ser::color_lut::solve_with_precomputed_q(
 }
 
 ser::coefficients ser::color_lut::look_up(const QColor& color) const {
-    // Sample the coefficient vector using Trilinear Interpolation
-    float r_pos = color.red() * (LUT_GRID_SIZE - 1) / 255.0f;
-    float g_pos = color.green() * (LUT_GRID_SIZE - 1) / 255.0f;
-    float b_pos = color.blue() * (LUT_GRID_SIZE - 1) / 255.0f;
+    QRgb rgb = color.rgb();
+    if (lazy_) ensure_cell(rgb);
+    ser::coefficients result(palette_.size());
+    interpolate(interpolation_, data(), static_cast<int>(palette_.size()), grid_size_, rgb, [&](int i, float v) {
+        result[i] = v;
+        });
+    return result;
+}
 
-    int r0 = clamp(static_cast<int>(r_pos), 0, LUT_GRID_SIZE - 2);
-    int g0 = clamp(static_cast<int>(g_pos), 0, LUT_GRID_SIZE - 2);
-    int b0 = clamp(static_cast<int>(b_pos), 0, LUT_GRID_SIZE - 2);
+void ser::color_lut::look_up(const QColor& color, std::span<float> k) const {
+    QRgb rgb = color.rgb();
+    if (lazy_) ensure_cell(rgb);
+    interpolate(interpolation_, data(), static_cast<int>(palette_.size()), grid_size_, rgb, [&](int i, float v) {
+        k[i] = v;
+        });
+}
 
-    int r1 = r0 + 1;
-    int g1 = g0 + 1;
-    int b1 = b0 + 1;
+void ser::color_lut::look_up_row(const QRgb* pixels, int count, float* const* out_rows) const {
+    if (lazy_) {
+        for (int x = 0; x < count; ++x) ensure_cell(pixels[x]);
+    }
+    interpolate_row(interpolation_, data(), static_cast<int>(palette_.size()), grid_size_, pixels, count, out_rows);
+}
 
-    float tr = r_pos - r0;
-    float tg = g_pos - g0;
-    float tb = b_pos - b0;
+void ser::color_lut::look_up_row(const QRgb* pixels, int count, double* const* out_rows) const {
+    if (lazy_) {
+        for (int x = 0; x < count; ++x) ensure_cell(pixels[x]);
+    }
+    interpolate_row(interpolation_, data(), static_cast<int>(palette_.size()), grid_size_, pixels, count, out_rows);
+}
 
-    const auto& c000 = impl_[r0][g0][b0];
-    const auto& c100 = impl_[r1][g0][b0];
-    const auto& c010 = impl_[r0][g1][b0];
-    const auto& c110 = impl_[r1][g1][b0];
-    const auto& c001 = impl_[r0][g0][b1];
-    const auto& c101 = impl_[r1][g0][b1];
-    const auto& c011 = impl_[r0][g1][b1];
-    const auto& c111 = impl_[r1][g1][b1];
+std::span<const float> ser::color_lut::node(int r, int g, int b) const {
+    if (lazy_) ensure_node(r, g, b);
+    size_t n = palette_.size();
+    return { data() + node_index(r, g, b, grid_size_) * n, n };
+}
 
-    size_t n_coeffs = c000.size();
-    ser::coefficients result(n_coeffs);
+const float* ser::color_lut::data() const {
+    if (lazy_) return lazy_->values.data();
+    return mapped_ ? mapped_->coefficients().data() : impl_.data();
+}
 
-    for (size_t i = 0; i < n_coeffs; ++i) {
-        float c00 = c000[i] * (1 - tr) + c100[i] * tr;
-        float c01 = c001[i] * (1 - tr) + c101[i] * tr;
-        float c10 = c010[i] * (1 - tr) + c110[i] * tr;
-        float c11 = c011[i] * (1 - tr) + c111[i] * tr;
+std::span<float> ser::color_lut::node_data(int r, int g, int b) {
+    size_t n = palette_.size();
+    return { impl_.data() + node_index(r, g, b, grid_size_) * n, n };
+}
 
-        float c0 = c00 * (1 - tg) + c10 * tg;
-        float c1 = c01 * (1 - tg) + c11 * tg;
+void ser::color_lut::set_interpolation(interpolation mode) {
+    interpolation_ = mode;
+}
 
-        result[i] = c0 * (1 - tb) + c1 * tb;
-    }
+ser::interpolation ser::color_lut::interpolation_mode() const {
+    return interpolation_;
+}
 
-    return result;
+int ser::color_lut::grid_size() const {
+    return grid_size_;
+}
+
+int ser::color_lut::full_grid_size() {
+    return LUT_GRID_SIZE;
+}
+
+double ser::color_lut::lambda() {
+    return LAMBDA;
+}
+
+size_t ser::color_lut::memory_usage() const {
+    size_t mapped = mapped_ ? mapped_->coefficients().size_bytes() : 0;
+    size_t lazy = lazy_ ? lazy_->values.capacity() * sizeof(float) : 0;
+    return mapped + lazy + impl_.capacity() * sizeof(float) + palette_.capacity() * sizeof(latent_space_color);
 }
 
 const std::vector<ser::latent_space_color>& ser::color_lut::palette() const {
     return palette_;
 }
 
+const std::vector<QColor>& ser::color_lut::source_palette() const {
+    return source_palette_;
+}
+
+const ser::bake_stats& ser::color_lut::stats() const {
+    return stats_;
+}
+
+double ser::bake_stats::average_iterations() const {
+    return nodes > 0 ? static_cast<double>(iterations) / nodes : 0.0;
+}
+
 // -------------------------------------------------------------------------
 // ser:: Free Functions
 // -------------------------------------------------------------------------
@@ -1,35 +1,159 @@
 #pragma once
 
+#include "aligned_allocator.hpp"
+#include "job_control.hpp"
 #include <vector>
 #include <array>
+#include <functional>
+#include <memory>
+#include <span>
 #include <QColor>
 
 class CoinPackedMatrix;
+class QImage;
 
 namespace ser {
 
+    class lut_file;
+
     using coefficients = std::vector<double>;
     using latent_space_color = std::array<float, 7>;
 
+    // Which solver bakes the lattice nodes. active_set is the dedicated
+    // small-palette solver in qp_solver.hpp; clp is the original ClpSimplex
+    // barrier path, kept for reference and cross-checking.
+    enum class qp_backend {
+        active_set,
+        clp
+    };
+
+    // How look_up blends the lattice nodes around a color. Tetrahedral
+    // splits each cell into six tetrahedra along its main diagonal and
+    // blends the 4 corners of the one containing the color, instead of
+    // all 8 corners of the cell.
+    enum class interpolation {
+        trilinear,
+        tetrahedral
+    };
+
+    // Solver effort of the last bake, reported by color_lut::stats()
+    struct bake_stats {
+        int nodes = 0;
+        long long iterations = 0;
+        int factorizations = 0;
+
+        double average_iterations() const;
+    };
+
+    // The lattice is stored as one 64-byte aligned float buffer, node-major
+    // with the ink coefficients of a node contiguous and blue varying
+    // fastest. The 8 corners of a cell are therefore four runs of two
+    // adjacent nodes each. A LUT found in the on-disk cache (lut_cache.hpp)
+    // is used straight from the memory-mapped file instead.
+    //
+    // In lazy mode only the nodes around colors of a given image are solved
+    // up front; any other cell is solved, thread-safely, the first time
+    // look_up or node() lands in it. Nodes solved on demand start cold
+    // where an eager bake warm-starts from a neighbour, so where an ink sits
+    // on the edge of the active set the two paths may settle on different
+    // (equally optimal) sets. The QP is strictly convex, so the coefficients
+    // still agree to within 1e-6; they are not guaranteed bit-identical,
+    // and a lazy LUT is never written to the cache.
     class color_lut {
 
-        std::vector<std::vector<std::vector<coefficients>>> impl_;
+        struct lazy_state;
+
+        aligned_vector<float> impl_;
+        std::shared_ptr<const lut_file> mapped_;
+        std::shared_ptr<lazy_state> lazy_;
+        std::vector<QColor> source_palette_;
         std::vector<latent_space_color> palette_;
+        qp_backend backend_ = qp_backend::active_set;
+        interpolation interpolation_ = interpolation::trilinear;
+        int grid_size_ = 0;
+        bake_stats stats_;
 
         static coefficients solve_with_precomputed_q(
             const std::vector<latent_space_color>& palette,
             const ser::latent_space_color& target,
             const CoinPackedMatrix& Q);
 
+        bool bake_active_set(const job_control& job);
+        bool bake_clp(const job_control& job);
+        int rebake_delta(const std::vector<QColor>& palette,
+            const std::function<void(std::span<const float>, coefficients&)>& warm_start,
+            const job_control& job);
+        void store_in_cache() const;
+        void ensure_cell(QRgb rgb) const;
+        void ensure_node(int r, int g, int b) const;
+        const float* data() const;
+        std::span<float> node_data(int r, int g, int b);
+
     public:
 
         color_lut() {}
 
-        color_lut(const std::vector<QColor>& palette);
-        void reset_palette(const std::vector<QColor>& palette);
+        color_lut(const std::vector<QColor>& palette, qp_backend backend = qp_backend::active_set);
+        color_lut(const std::vector<QColor>& palette, const QImage& footprint,
+            qp_backend backend = qp_backend::active_set);
+        // The palette-changing calls below accept a job_control for progress
+        // and cancellation. A cancelled bake leaves the LUT empty, with an
+        // empty palette, and the calls that return a node count return -1.
+        void reset_palette(const std::vector<QColor>& palette, const job_control& job = {});
+        void reset_palette(const std::vector<QColor>& palette, const QImage& footprint);
+        bool is_lazy() const;
+
+        // Solves whatever a lazy LUT has not reached yet. node() solves a
+        // missing node on its own, but code reading the whole lattice should
+        // call this first. Does nothing for other LUTs.
+        void solve_all() const;
+
+        // Delta updates of a single source palette entry. The existing
+        // coefficients are carried over as warm starts and only nodes whose
+        // optimality conditions no longer hold are re-solved. Each returns the
+        // number of nodes it re-solved.
+        int insert_ink(int index, const QColor& color, const job_control& job = {});
+        int remove_ink(int index, const job_control& job = {});
+        int replace_ink(int index, const QColor& color, const job_control& job = {});
+
+        // Moves to the given palette, as a delta update if it differs from the
+        // current one by a single insertion, removal or replacement and by a
+        // full re-bake otherwise. Returns the number of nodes solved.
+        int update_palette(const std::vector<QColor>& palette, const job_control& job = {});
+        bool can_update_incrementally(const std::vector<QColor>& palette) const;
+
+        // Coarse-to-fine baking for a quick first answer. reset_preview bakes
+        // a 9x9x9 lattice, or maps the full LUT if it is in the cache; each
+        // refine() then doubles the resolution, 9 -> 17 -> 33. The levels
+        // are nested, so refine keeps every node it has and solves only the
+        // ones in between, warm-started from their coarse neighbours. Both
+        // return the number of nodes solved.
+        int reset_preview(const std::vector<QColor>& palette, const job_control& job = {});
+        int refine(const job_control& job = {});
+        bool is_refined() const;
+
         coefficients look_up(const QColor& color) const;
+        void look_up(const QColor& color, std::span<float> k) const;
+
+        // Batch lookup of count packed RGB32 pixels, allocation free. Ink i of
+        // pixel x is written to out_rows[i][x]. The blend runs eight pixels
+        // at a time with AVX2 when the build has the kernel and the CPU
+        // supports it.
+        void look_up_row(const QRgb* pixels, int count, float* const* out_rows) const;
+        void look_up_row(const QRgb* pixels, int count, double* const* out_rows) const;
+
+        void set_interpolation(interpolation mode);
+        interpolation interpolation_mode() const;
+
+        std::span<const float> node(int r, int g, int b) const;
+        int grid_size() const;
+        static int full_grid_size();
+        static double lambda();
+        size_t memory_usage() const;
 
         const std::vector<latent_space_color>& palette() const;
+        const std::vector<QColor>& source_palette() const;
+        const bake_stats& stats() const;
     };
 
     std::vector<latent_space_color> to_latent_space(const std::vector<QColor>& colors);
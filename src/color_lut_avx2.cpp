@@ -0,0 +1,149 @@
+#include "lut_kernels.hpp"
+
+#include <algorithm>
+#include <immintrin.h>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+// This unit alone is built with AVX2 and FMA enabled.
+namespace {
+
+    void store8(float* dst, __m256 v) {
+        _mm256_storeu_ps(dst, v);
+    }
+
+    void store8(double* dst, __m256 v) {
+        _mm256_storeu_pd(dst, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+        _mm256_storeu_pd(dst + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+    }
+
+    __m256 lerp8(__m256 a, __m256 b, __m256 t) {
+        return _mm256_fmadd_ps(t, _mm256_sub_ps(b, a), a);
+    }
+
+    // Transposes eight rows of eight floats in place
+    void transpose8(__m256 (&v)[8]) {
+        __m256 t0 = _mm256_unpacklo_ps(v[0], v[1]);
+        __m256 t1 = _mm256_unpackhi_ps(v[0], v[1]);
+        __m256 t2 = _mm256_unpacklo_ps(v[2], v[3]);
+        __m256 t3 = _mm256_unpackhi_ps(v[2], v[3]);
+        __m256 t4 = _mm256_unpacklo_ps(v[4], v[5]);
+        __m256 t5 = _mm256_unpackhi_ps(v[4], v[5]);
+        __m256 t6 = _mm256_unpacklo_ps(v[6], v[7]);
+        __m256 t7 = _mm256_unpackhi_ps(v[6], v[7]);
+        __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+        v[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+        v[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+        v[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+        v[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+        v[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+        v[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+        v[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+        v[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+    }
+
+    // Interpolation of eight pixels at a time. Cell positions and weights
+    // are computed for all eight in parallel; the blend then runs across
+    // the inks of each pixel, eight inks per vector, since the ink
+    // coefficients of a node are contiguous. An 8x8 transpose turns the
+    // pixel-major results into eight pixels of each ink's output row.
+    // Returns the number of pixels done, a multiple of eight.
+    template <ser::interpolation Mode, typename T>
+    int interpolate_row_avx2(const float* lut, int n, int grid, const QRgb* pixels, int count, T* const* out_rows) {
+        const int r_stride = grid * grid * n;
+        const int g_stride = grid * n;
+
+        // Loads of the last, partial block of inks are masked so they never
+        // read past the end of the lattice
+        alignas(32) int lanes[8];
+        for (int lane = 0; lane < 8; ++lane) lanes[lane] = lane;
+        const __m256i lane_index = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes));
+
+        alignas(32) float tr[8], tg[8], tb[8];
+        alignas(32) int base[8];
+        alignas(32) float w[4][8];
+        alignas(32) int first[8], second[8];
+        int x = 0;
+        for (; x + 8 <= count; x += 8) {
+            __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + x));
+            lattice_position8 pos = locate8(px, grid, n);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(base), pos.base);
+
+            if constexpr (Mode == ser::interpolation::tetrahedral) {
+                tetrahedron8 t = select_tetrahedron8(pos.tr, pos.tg, pos.tb, r_stride, g_stride, n);
+                for (int c = 0; c < 4; ++c) {
+                    _mm256_store_ps(w[c], t.w[c]);
+                }
+                _mm256_store_si256(reinterpret_cast<__m256i*>(first), t.first);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(second), t.second);
+            } else {
+                _mm256_store_ps(tr, pos.tr);
+                _mm256_store_ps(tg, pos.tg);
+                _mm256_store_ps(tb, pos.tb);
+            }
+
+            for (int i0 = 0; i0 < n; i0 += 8) {
+                const int inks = std::min(8, n - i0);
+                const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(inks), lane_index);
+
+                __m256 v[8];
+                for (int p = 0; p < 8; ++p) {
+                    const float* c00x = lut + base[p] + i0;
+                    if constexpr (Mode == ser::interpolation::tetrahedral) {
+                        __m256 c = _mm256_mul_ps(_mm256_set1_ps(w[0][p]), _mm256_maskload_ps(c00x, mask));
+                        c = _mm256_fmadd_ps(_mm256_set1_ps(w[1][p]), _mm256_maskload_ps(c00x + first[p], mask), c);
+                        c = _mm256_fmadd_ps(_mm256_set1_ps(w[2][p]), _mm256_maskload_ps(c00x + second[p], mask), c);
+                        v[p] = _mm256_fmadd_ps(_mm256_set1_ps(w[3][p]),
+                            _mm256_maskload_ps(c00x + r_stride + g_stride + n, mask), c);
+                    } else {
+                        const float* c01x = c00x + g_stride;
+                        const float* c10x = c00x + r_stride;
+                        const float* c11x = c10x + g_stride;
+                        const __m256 wb = _mm256_set1_ps(tb[p]);
+                        __m256 c00 = lerp8(_mm256_maskload_ps(c00x, mask), _mm256_maskload_ps(c00x + n, mask), wb);
+                        __m256 c01 = lerp8(_mm256_maskload_ps(c01x, mask), _mm256_maskload_ps(c01x + n, mask), wb);
+                        __m256 c10 = lerp8(_mm256_maskload_ps(c10x, mask), _mm256_maskload_ps(c10x + n, mask), wb);
+                        __m256 c11 = lerp8(_mm256_maskload_ps(c11x, mask), _mm256_maskload_ps(c11x + n, mask), wb);
+                        const __m256 wg = _mm256_set1_ps(tg[p]);
+                        v[p] = lerp8(lerp8(c00, c01, wg), lerp8(c10, c11, wg), _mm256_set1_ps(tr[p]));
+                    }
+                }
+
+                transpose8(v);
+                for (int i = 0; i < inks; ++i) {
+                    store8(out_rows[i0 + i] + x, v[i]);
+                }
+            }
+        }
+        return x;
+    }
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser::kernels Free Functions
+// -------------------------------------------------------------------------
+
+int ser::kernels::interpolate_row_avx2(interpolation mode, const float* lut, int n, int grid,
+        const QRgb* pixels, int count, float* const* out_rows) {
+    if (mode == interpolation::tetrahedral) {
+        return ::interpolate_row_avx2<interpolation::tetrahedral>(lut, n, grid, pixels, count, out_rows);
+    }
+    return ::interpolate_row_avx2<interpolation::trilinear>(lut, n, grid, pixels, count, out_rows);
+}
+
+int ser::kernels::interpolate_row_avx2(interpolation mode, const float* lut, int n, int grid,
+        const QRgb* pixels, int count, double* const* out_rows) {
+    if (mode == interpolation::tetrahedral) {
+        return ::interpolate_row_avx2<interpolation::tetrahedral>(lut, n, grid, pixels, count, out_rows);
+    }
+    return ::interpolate_row_avx2<interpolation::trilinear>(lut, n, grid, pixels, count, out_rows);
+}
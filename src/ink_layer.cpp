@@ -1,18 +1,158 @@
 #include "ink_layer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
 
-ser::ink_layer::ink_layer(int wd, int hgt) : impl_(wd * hgt, 0.0), wd_(wd), hgt_(hgt) {
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+namespace {
+
+    constexpr size_t ARENA_ALIGNMENT = 64;
+
+    template <typename T>
+    T quantize(float k) {
+        constexpr float max = static_cast<float>(std::numeric_limits<T>::max());
+        return static_cast<T>(std::clamp(k, 0.0f, 1.0f) * max + 0.5f);
+    }
+
+    template <typename T>
+    float dequantize(T v) {
+        constexpr float scale = 1.0f / std::numeric_limits<T>::max();
+        return v * scale;
+    }
+
+    template <typename T>
+    void read_fixed(const void* src, int count, float* k) {
+        const T* v = static_cast<const T*>(src);
+        for (int x = 0; x < count; ++x) {
+            k[x] = dequantize(v[x]);
+        }
+    }
+
+    template <typename T>
+    void write_fixed(void* dst, int count, const float* k) {
+        T* v = static_cast<T*>(dst);
+        for (int x = 0; x < count; ++x) {
+            v[x] = quantize<T>(k[x]);
+        }
+    }
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser::const_ink_layer Implementation
+// -------------------------------------------------------------------------
+
+ser::const_ink_layer::const_ink_layer(const std::byte* data, int wd, int hgt, ink_format format) :
+        data_(data), wd_(wd), hgt_(hgt), format_(format) {
+}
+
+double ser::const_ink_layer::operator()(int x, int y) const {
+    switch (format_) {
+    case ink_format::uint16:
+        return dequantize(row<uint16_t>(y)[x]);
+    case ink_format::uint8:
+        return dequantize(row<uint8_t>(y)[x]);
+    default:
+        return row<float>(y)[x];
+    }
+}
+
+const void* ser::const_ink_layer::row_data(int y) const {
+    return data_ + static_cast<size_t>(y) * wd_ * element_size(format_);
+}
+
+void ser::const_ink_layer::read_row(int y, float* k) const {
+    read_row(y, 0, wd_, k);
+}
+
+void ser::const_ink_layer::read_row(int y, int x0, int count, float* k) const {
+    const std::byte* src = static_cast<const std::byte*>(row_data(y)) + x0 * element_size(format_);
+    switch (format_) {
+    case ink_format::uint16:
+        read_fixed<uint16_t>(src, count, k);
+        break;
+    case ink_format::uint8:
+        read_fixed<uint8_t>(src, count, k);
+        break;
+    default:
+        std::memcpy(k, src, count * sizeof(float));
+        break;
+    }
+}
+
+int ser::const_ink_layer::width() const {
+    return wd_;
+}
+
+int ser::const_ink_layer::height() const {
+    return hgt_;
+}
+
+ser::ink_format ser::const_ink_layer::format() const {
+    return format_;
+}
+
+// -------------------------------------------------------------------------
+// ser::ink_layer Implementation
+// -------------------------------------------------------------------------
+
+ser::ink_layer::ink_layer(std::byte* data, int wd, int hgt, ink_format format) :
+        data_(data), wd_(wd), hgt_(hgt), format_(format) {
+}
+
+ser::ink_layer::operator const_ink_layer() const {
+    return { data_, wd_, hgt_, format_ };
 }
 
 size_t ser::ink_layer::index(int x, int y) const {
-    return x + y * wd_;
+    return static_cast<size_t>(x) + static_cast<size_t>(y) * wd_;
 }
 
 double ser::ink_layer::operator()(int x, int y) const {
-    return impl_[index(x, y)];
+    return const_ink_layer(*this)(x, y);
+}
+
+void ser::ink_layer::set(int x, int y, double k) {
+    float v = static_cast<float>(k);
+    write_row(y, x, 1, &v);
+}
+
+void* ser::ink_layer::row_data(int y) {
+    return data_ + index(0, y) * element_size(format_);
+}
+
+const void* ser::ink_layer::row_data(int y) const {
+    return data_ + index(0, y) * element_size(format_);
 }
 
-double& ser::ink_layer::operator()(int x, int y) {
-    return impl_[index(x, y)];
+void ser::ink_layer::read_row(int y, float* k) const {
+    const_ink_layer(*this).read_row(y, k);
+}
+
+void ser::ink_layer::read_row(int y, int x0, int count, float* k) const {
+    const_ink_layer(*this).read_row(y, x0, count, k);
+}
+
+void ser::ink_layer::write_row(int y, const float* k) {
+    write_row(y, 0, wd_, k);
+}
+
+void ser::ink_layer::write_row(int y, int x0, int count, const float* k) {
+    std::byte* dst = static_cast<std::byte*>(row_data(y)) + x0 * element_size(format_);
+    switch (format_) {
+    case ink_format::uint16:
+        write_fixed<uint16_t>(dst, count, k);
+        break;
+    case ink_format::uint8:
+        write_fixed<uint8_t>(dst, count, k);
+        break;
+    default:
+        std::memcpy(dst, k, count * sizeof(float));
+        break;
+    }
 }
 
 int ser::ink_layer::width() const {
@@ -22,3 +162,190 @@ int ser::ink_layer::width() const {
 int ser::ink_layer::height() const {
     return hgt_;
 }
+
+ser::ink_format ser::ink_layer::format() const {
+    return format_;
+}
+
+// -------------------------------------------------------------------------
+// ser::ink_separation Implementation
+// -------------------------------------------------------------------------
+
+ser::ink_separation::ink_separation(size_t inks, int wd, int hgt, ink_format format) :
+        inks_(inks), wd_(wd), hgt_(hgt), format_(format) {
+    size_t bytes = static_cast<size_t>(wd) * hgt * element_size(format);
+    plane_bytes_ = (bytes + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    arena_.resize(inks_ * plane_bytes_);
+
+    words_per_tile_ = (inks_ + 63) / 64;
+    tile_inks_.assign(static_cast<size_t>(tiles_x()) * tiles_y() * words_per_tile_, 0);
+}
+
+size_t ser::ink_separation::size() const {
+    return inks_;
+}
+
+bool ser::ink_separation::empty() const {
+    return inks_ == 0;
+}
+
+ser::ink_layer ser::ink_separation::operator[](size_t i) {
+    return { arena_.data() + i * plane_bytes_, wd_, hgt_, format_ };
+}
+
+ser::const_ink_layer ser::ink_separation::operator[](size_t i) const {
+    return { arena_.data() + i * plane_bytes_, wd_, hgt_, format_ };
+}
+
+int ser::ink_separation::width() const {
+    return wd_;
+}
+
+int ser::ink_separation::height() const {
+    return hgt_;
+}
+
+ser::ink_format ser::ink_separation::format() const {
+    return format_;
+}
+
+size_t ser::ink_separation::memory_usage() const {
+    return arena_.capacity() + tile_inks_.capacity() * sizeof(uint64_t);
+}
+
+int ser::ink_separation::tiles_x() const {
+    return (wd_ + TILE_WIDTH - 1) / TILE_WIDTH;
+}
+
+int ser::ink_separation::tiles_y() const {
+    return (hgt_ + TILE_HEIGHT - 1) / TILE_HEIGHT;
+}
+
+void ser::ink_separation::mark_ink(int tile, size_t ink) {
+    tile_inks_[tile * words_per_tile_ + ink / 64] |= uint64_t(1) << (ink % 64);
+}
+
+bool ser::ink_separation::has_ink(int tile, size_t ink) const {
+    return (tile_inks_[tile * words_per_tile_ + ink / 64] >> (ink % 64)) & 1;
+}
+
+std::vector<int> ser::ink_separation::tiles_with_ink(size_t ink) const {
+    std::vector<int> tiles;
+    const int count = tiles_x() * tiles_y();
+    for (int tile = 0; tile < count; ++tile) {
+        if (has_ink(tile, ink)) tiles.push_back(tile);
+    }
+    return tiles;
+}
+
+// -------------------------------------------------------------------------
+// ser::sparse_separation Implementation
+// -------------------------------------------------------------------------
+
+ser::sparse_separation::sparse_separation(size_t inks, int k, int wd, int hgt) :
+        inks_(inks), k_(k), wd_(wd), hgt_(hgt) {
+    size_t pixels = static_cast<size_t>(wd) * hgt;
+    index_plane_bytes_ = (pixels * sizeof(uint8_t) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    weight_plane_bytes_ = (pixels * sizeof(uint16_t) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    arena_.resize(k_ * (index_plane_bytes_ + weight_plane_bytes_));
+}
+
+size_t ser::sparse_separation::inks() const {
+    return inks_;
+}
+
+int ser::sparse_separation::k() const {
+    return k_;
+}
+
+bool ser::sparse_separation::empty() const {
+    return k_ == 0;
+}
+
+int ser::sparse_separation::width() const {
+    return wd_;
+}
+
+int ser::sparse_separation::height() const {
+    return hgt_;
+}
+
+size_t ser::sparse_separation::memory_usage() const {
+    return arena_.capacity();
+}
+
+uint8_t* ser::sparse_separation::ink_row(int slot, int y) {
+    return reinterpret_cast<uint8_t*>(arena_.data() + slot * index_plane_bytes_) + static_cast<size_t>(y) * wd_;
+}
+
+const uint8_t* ser::sparse_separation::ink_row(int slot, int y) const {
+    return reinterpret_cast<const uint8_t*>(arena_.data() + slot * index_plane_bytes_) + static_cast<size_t>(y) * wd_;
+}
+
+uint16_t* ser::sparse_separation::weight_row(int slot, int y) {
+    // Weight planes follow all K index planes
+    std::byte* plane = arena_.data() + k_ * index_plane_bytes_ + slot * weight_plane_bytes_;
+    return reinterpret_cast<uint16_t*>(plane) + static_cast<size_t>(y) * wd_;
+}
+
+const uint16_t* ser::sparse_separation::weight_row(int slot, int y) const {
+    const std::byte* plane = arena_.data() + k_ * index_plane_bytes_ + slot * weight_plane_bytes_;
+    return reinterpret_cast<const uint16_t*>(plane) + static_cast<size_t>(y) * wd_;
+}
+
+void ser::sparse_separation::read_weights(int slot, int y, float* w) const {
+    read_fixed<uint16_t>(weight_row(slot, y), wd_, w);
+}
+
+void ser::sparse_separation::write_weights(int slot, int y, const float* w) {
+    write_fixed<uint16_t>(weight_row(slot, y), wd_, w);
+}
+
+double ser::sparse_separation::operator()(size_t ink, int x, int y) const {
+    for (int j = 0; j < k_; ++j) {
+        if (ink_row(j, y)[x] == ink) {
+            return dequantize(weight_row(j, y)[x]);
+        }
+    }
+    return 0.0;
+}
+
+ser::ink_separation ser::sparse_separation::to_dense(ink_format format) const {
+    ink_separation dense(inks_, wd_, hgt_, format);
+    std::vector<float> coverage(inks_ * wd_);
+    for (int y = 0; y < hgt_; ++y) {
+        std::fill(coverage.begin(), coverage.end(), 0.0f);
+        for (int j = 0; j < k_; ++j) {
+            const uint8_t* inks = ink_row(j, y);
+            const uint16_t* weights = weight_row(j, y);
+            for (int x = 0; x < wd_; ++x) {
+                coverage[inks[x] * wd_ + x] += dequantize(weights[x]);
+            }
+        }
+        for (size_t i = 0; i < inks_; ++i) {
+            const float* k = coverage.data() + i * wd_;
+            dense[i].write_row(y, k);
+            for (int x = 0; x < wd_; ++x) {
+                if (k[x] > COVERAGE_EPSILON) {
+                    dense.mark_ink((y / ink_separation::TILE_HEIGHT) * dense.tiles_x() + x / ink_separation::TILE_WIDTH, i);
+                }
+            }
+        }
+    }
+    return dense;
+}
+
+// -------------------------------------------------------------------------
+// ser:: Free Functions
+// -------------------------------------------------------------------------
+
+size_t ser::element_size(ink_format format) {
+    switch (format) {
+    case ink_format::uint16:
+        return sizeof(uint16_t);
+    case ink_format::uint8:
+        return sizeof(uint8_t);
+    default:
+        return sizeof(float);
+    }
+}
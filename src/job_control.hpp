@@ -0,0 +1,34 @@
+#pragma once
+
+#include <functional>
+#include <stop_token>
+
+namespace ser {
+
+    // Cooperative cancellation and progress reporting for long-running work
+    // such as bakes and separations. Work polls stop_requested() between
+    // units and reports its completed fraction in [0, 1] through report(),
+    // possibly from worker threads. A default-constructed job_control never
+    // stops and reports nowhere.
+    struct job_control {
+        std::stop_token stop;
+        std::function<void(double)> progress;
+
+        bool stop_requested() const {
+            return stop.stop_requested();
+        }
+
+        void report(double fraction) const {
+            if (progress) progress(fraction);
+        }
+
+        // Control for a step that covers [begin, end] of this job's progress
+        job_control step(double begin, double end) const {
+            if (!progress) return { stop, {} };
+            return { stop, [progress = progress, begin, end](double fraction) {
+                progress(begin + (end - begin) * fraction);
+                } };
+        }
+    };
+
+}
@@ -0,0 +1,305 @@
+#include "lut_cache.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <mutex>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+namespace {
+
+    constexpr char LUT_MAGIC[8] = { 'S', 'E', 'R', 'I', 'L', 'U', 'T', '\0' };
+
+    // Bump whenever the on-disk layout changes
+    constexpr uint32_t LUT_FILE_VERSION = 1;
+
+    constexpr size_t LUT_ALIGNMENT = 64;
+
+    struct lut_file_header {
+        char magic[8];
+        uint32_t file_version;
+        uint32_t solver_version;
+        uint64_t key;
+        uint32_t grid_size;
+        uint32_t ink_count;
+        double lambda;
+        uint64_t payload_bytes;
+        uint64_t payload_checksum;
+        uint64_t reserved;
+    };
+    static_assert(sizeof(lut_file_header) == LUT_ALIGNMENT);
+
+    constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+    constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+    // FNV-1a over 32-bit words
+    uint64_t fnv1a(uint64_t h, std::span<const uint32_t> words) {
+        for (uint32_t w : words) {
+            h ^= w;
+            h *= FNV_PRIME;
+        }
+        return h;
+    }
+
+    uint64_t payload_checksum(std::span<const float> coefficients) {
+        return fnv1a(FNV_OFFSET, { reinterpret_cast<const uint32_t*>(coefficients.data()), coefficients.size() });
+    }
+
+    size_t palette_bytes(size_t ink_count) {
+        size_t bytes = ink_count * sizeof(QRgb);
+        return (bytes + LUT_ALIGNMENT - 1) / LUT_ALIGNMENT * LUT_ALIGNMENT;
+    }
+
+    size_t payload_floats(const ser::lut_key& key) {
+        return key.palette.size() * key.grid_size * key.grid_size * key.grid_size;
+    }
+
+    // Checks the header fields every cache file shares against key
+    bool header_matches(const lut_file_header& header, const ser::lut_key& key) {
+        return std::equal(std::begin(LUT_MAGIC), std::end(LUT_MAGIC), header.magic) &&
+            header.file_version == LUT_FILE_VERSION &&
+            header.solver_version == key.solver_version &&
+            header.key == key.hash() &&
+            header.grid_size == static_cast<uint32_t>(key.grid_size) &&
+            header.ink_count == key.palette.size() &&
+            header.lambda == key.lambda;
+    }
+
+    lut_file_header make_header(const ser::lut_key& key) {
+        lut_file_header header{};
+        std::copy(std::begin(LUT_MAGIC), std::end(LUT_MAGIC), header.magic);
+        header.file_version = LUT_FILE_VERSION;
+        header.solver_version = key.solver_version;
+        header.key = key.hash();
+        header.grid_size = static_cast<uint32_t>(key.grid_size);
+        header.ink_count = static_cast<uint32_t>(key.palette.size());
+        header.lambda = key.lambda;
+        return header;
+    }
+
+    std::vector<QRgb> padded_palette(const ser::lut_key& key) {
+        std::vector<QRgb> palette(palette_bytes(key.palette.size()) / sizeof(QRgb), 0);
+        for (size_t i = 0; i < key.palette.size(); ++i) {
+            palette[i] = key.palette[i].rgb();
+        }
+        return palette;
+    }
+
+    // Path in the cache directory of the file named by pattern, with %1
+    // standing for the key's hash
+    QString cache_file_path(const ser::lut_key& key, const char* pattern) {
+        QString dir = ser::lut_cache_directory();
+        if (dir.isEmpty()) {
+            return {};
+        }
+        return QDir(dir).filePath(QString(pattern).arg(static_cast<qulonglong>(key.hash()), 16, 16, QChar('0')));
+    }
+
+    std::mutex cache_dir_mutex;
+    bool cache_dir_set = false;
+    QString cache_dir;
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser::lut_key Implementation
+// -------------------------------------------------------------------------
+
+uint64_t ser::lut_key::hash() const {
+    std::vector<uint32_t> words;
+    words.push_back(solver_version);
+    words.push_back(static_cast<uint32_t>(grid_size));
+    uint64_t lambda_bits = std::bit_cast<uint64_t>(lambda);
+    words.push_back(static_cast<uint32_t>(lambda_bits));
+    words.push_back(static_cast<uint32_t>(lambda_bits >> 32));
+    words.push_back(static_cast<uint32_t>(palette.size()));
+    for (const auto& c : palette) {
+        words.push_back(c.rgb());
+    }
+    return fnv1a(FNV_OFFSET, words);
+}
+
+// -------------------------------------------------------------------------
+// ser::lut_file Implementation
+// -------------------------------------------------------------------------
+
+ser::lut_file::lut_file(std::unique_ptr<QFile> file, const float* data, size_t size) :
+        file_(std::move(file)), data_(data), size_(size) {
+}
+
+ser::lut_file::~lut_file() = default;
+
+std::span<const float> ser::lut_file::coefficients() const {
+    return { data_, size_ };
+}
+
+std::shared_ptr<const ser::lut_file> ser::lut_file::open(const QString& path, const lut_key& key) {
+    if (path.isEmpty() || !QFile::exists(path)) {
+        return nullptr;
+    }
+
+    auto file = std::make_unique<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+
+    const size_t n = key.palette.size();
+    const size_t floats = payload_floats(key);
+    const size_t payload_offset = sizeof(lut_file_header) + palette_bytes(n);
+    if (static_cast<size_t>(file->size()) != payload_offset + floats * sizeof(float)) {
+        return nullptr;
+    }
+
+    const uchar* map = file->map(0, file->size());
+    if (!map) {
+        return nullptr;
+    }
+
+    lut_file_header header;
+    std::memcpy(&header, map, sizeof(header));
+    bool valid = header_matches(header, key) && header.payload_bytes == floats * sizeof(float);
+
+    // The hash could collide, so compare the palette itself too
+    for (size_t i = 0; valid && i < n; ++i) {
+        QRgb rgb;
+        std::memcpy(&rgb, map + sizeof(lut_file_header) + i * sizeof(QRgb), sizeof(rgb));
+        valid = (rgb == key.palette[i].rgb());
+    }
+
+    const float* data = reinterpret_cast<const float*>(map + payload_offset);
+    if (!valid || payload_checksum({ data, floats }) != header.payload_checksum) {
+        return nullptr;
+    }
+
+    return std::make_shared<const lut_file>(std::move(file), data, floats);
+}
+
+bool ser::lut_file::write(const QString& path, const lut_key& key, std::span<const float> coefficients) {
+    if (path.isEmpty() || coefficients.size() != payload_floats(key)) {
+        return false;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    // QSaveFile renames into place on commit, so readers never see a partial file
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    lut_file_header header = make_header(key);
+    header.payload_bytes = coefficients.size_bytes();
+    header.payload_checksum = payload_checksum(coefficients);
+    std::vector<QRgb> palette = padded_palette(key);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(palette.data()), palette.size() * sizeof(QRgb));
+    file.write(reinterpret_cast<const char*>(coefficients.data()), coefficients.size_bytes());
+    return file.commit();
+}
+
+// -------------------------------------------------------------------------
+// ser:: Free Functions
+// -------------------------------------------------------------------------
+
+bool ser::read_solution_file(const QString& path, const lut_key& key, std::vector<QRgb>& colors,
+        std::vector<float>& coefficients) {
+    if (path.isEmpty() || !QFile::exists(path)) {
+        return false;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray bytes = file.readAll();
+
+    // 1. Header and palette
+    const size_t n = key.palette.size();
+    const size_t payload_offset = sizeof(lut_file_header) + palette_bytes(n);
+    if (n == 0 || static_cast<size_t>(bytes.size()) < payload_offset) {
+        return false;
+    }
+    lut_file_header header;
+    std::memcpy(&header, bytes.constData(), sizeof(header));
+    const size_t entry_bytes = sizeof(QRgb) + n * sizeof(float);
+    bool valid = header_matches(header, key) &&
+        header.payload_bytes % entry_bytes == 0 &&
+        static_cast<size_t>(bytes.size()) == payload_offset + header.payload_bytes;
+    for (size_t i = 0; valid && i < n; ++i) {
+        QRgb rgb;
+        std::memcpy(&rgb, bytes.constData() + sizeof(lut_file_header) + i * sizeof(QRgb), sizeof(rgb));
+        valid = (rgb == key.palette[i].rgb());
+    }
+    if (!valid) {
+        return false;
+    }
+
+    // 2. Colors, then their coefficients
+    const size_t count = header.payload_bytes / entry_bytes;
+    const uint32_t* payload = reinterpret_cast<const uint32_t*>(bytes.constData() + payload_offset);
+    if (fnv1a(FNV_OFFSET, { payload, header.payload_bytes / sizeof(uint32_t) }) != header.payload_checksum) {
+        return false;
+    }
+    colors.resize(count);
+    coefficients.resize(count * n);
+    std::memcpy(colors.data(), payload, count * sizeof(QRgb));
+    std::memcpy(coefficients.data(), payload + count, coefficients.size() * sizeof(float));
+    return true;
+}
+
+bool ser::write_solution_file(const QString& path, const lut_key& key, std::span<const QRgb> colors,
+        std::span<const float> coefficients) {
+    if (path.isEmpty() || coefficients.size() != colors.size() * key.palette.size()) {
+        return false;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    lut_file_header header = make_header(key);
+    header.payload_bytes = colors.size_bytes() + coefficients.size_bytes();
+    uint64_t checksum = fnv1a(FNV_OFFSET, colors);
+    header.payload_checksum = fnv1a(checksum, { reinterpret_cast<const uint32_t*>(coefficients.data()), coefficients.size() });
+    std::vector<QRgb> palette = padded_palette(key);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(palette.data()), palette.size() * sizeof(QRgb));
+    file.write(reinterpret_cast<const char*>(colors.data()), colors.size_bytes());
+    file.write(reinterpret_cast<const char*>(coefficients.data()), coefficients.size_bytes());
+    return file.commit();
+}
+
+QString ser::lut_cache_directory() {
+    std::lock_guard lock(cache_dir_mutex);
+    if (!cache_dir_set) {
+        QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        cache_dir = base.isEmpty() ? QString() : QDir(base).filePath("luts");
+        cache_dir_set = true;
+    }
+    return cache_dir;
+}
+
+void ser::set_lut_cache_directory(const QString& dir) {
+    std::lock_guard lock(cache_dir_mutex);
+    cache_dir = dir;
+    cache_dir_set = true;
+}
+
+QString ser::lut_cache_path(const lut_key& key) {
+    return cache_file_path(key, "%1.lut");
+}
+
+QString ser::solution_cache_path(const lut_key& key) {
+    return cache_file_path(key, "%1.sol");
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QString>
+#include <QColor>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+class QFile;
+
+namespace ser {
+
+    // Everything a baked LUT depends on. Two LUTs with equal keys are
+    // interchangeable, so the key's hash names the file in the cache.
+    struct lut_key {
+        std::vector<QColor> palette;
+        int grid_size;
+        double lambda;
+        uint32_t solver_version;
+
+        uint64_t hash() const;
+    };
+
+    // A baked LUT file mapped read-only into memory. The file layout is
+    //
+    //     lut_file_header (64 bytes)
+    //     palette         (ink_count QRgb values, padded to 64 bytes)
+    //     coefficients    (ink_count * grid_size^3 floats, color_lut order)
+    //
+    // in native byte order. The header carries a format version and a
+    // checksum of the coefficients, so stale or corrupt files are rejected.
+    class lut_file {
+
+        std::unique_ptr<QFile> file_;
+        const float* data_ = nullptr;
+        size_t size_ = 0;
+
+    public:
+
+        lut_file(std::unique_ptr<QFile> file, const float* data, size_t size);
+        ~lut_file();
+
+        std::span<const float> coefficients() const;
+
+        // Maps the file at path if it exists and matches key, else nullptr
+        static std::shared_ptr<const lut_file> open(const QString& path, const lut_key& key);
+        static bool write(const QString& path, const lut_key& key, std::span<const float> coefficients);
+    };
+
+    // Exact per-color solutions for one palette, kept by
+    // exact_solution_cache. The file layout is
+    //
+    //     lut_file_header (64 bytes, grid_size 0)
+    //     palette         (ink_count QRgb values, padded to 64 bytes)
+    //     colors          (count QRgb values)
+    //     coefficients    (ink_count floats per color, in the order of colors)
+    //
+    // and the checksum covers colors and coefficients. The file grows
+    // between runs up to the cap exact_solution_cache keeps it under, and
+    // is small enough to be read into memory rather than mapped.
+    bool read_solution_file(const QString& path, const lut_key& key, std::vector<QRgb>& colors,
+        std::vector<float>& coefficients);
+    bool write_solution_file(const QString& path, const lut_key& key, std::span<const QRgb> colors,
+        std::span<const float> coefficients);
+
+    // Directory holding baked LUT files. Defaults to a "luts" folder in the
+    // platform cache location; an empty string disables the cache.
+    QString lut_cache_directory();
+    void set_lut_cache_directory(const QString& dir);
+
+    // Path of the cache file for key, or an empty string if caching is disabled
+    QString lut_cache_path(const lut_key& key);
+    QString solution_cache_path(const lut_key& key);
+
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "color_lut.hpp"
+#include <QColor>
+#include <algorithm>
+#include <cstddef>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// -------------------------------------------------------------------------
+// Lattice Helpers Shared by color_lut and reink_lut (Anonymous Namespace)
+// -------------------------------------------------------------------------
+// These have internal linkage on purpose: the kernel units are built with
+// other instruction sets, and an inline definition shared with them could
+// be merged into a copy that the CPU cannot run.
+namespace {
+
+    // Position of node (r, g, b) in a flat grid^3 lattice, in nodes
+    size_t node_index(int r, int g, int b, int grid) {
+        return (static_cast<size_t>(r) * grid + g) * grid + b;
+    }
+
+    // Lower corner node of the lattice cell a color falls into, and the
+    // color's fractional position inside that cell along each axis
+    struct lattice_position {
+        size_t node;
+        float tr, tg, tb;
+    };
+
+    lattice_position locate(QRgb rgb, int grid) {
+        float r_pos = qRed(rgb) * (grid - 1) / 255.0f;
+        float g_pos = qGreen(rgb) * (grid - 1) / 255.0f;
+        float b_pos = qBlue(rgb) * (grid - 1) / 255.0f;
+
+        int r0 = std::clamp(static_cast<int>(r_pos), 0, grid - 2);
+        int g0 = std::clamp(static_cast<int>(g_pos), 0, grid - 2);
+        int b0 = std::clamp(static_cast<int>(b_pos), 0, grid - 2);
+
+        return { node_index(r0, g0, b0, grid), r_pos - r0, g_pos - g0, b_pos - b0 };
+    }
+
+    // One of the six tetrahedra a cell splits into along its main diagonal.
+    // Its corners are the cell's lower corner, that corner stepped along
+    // the axis with the largest fraction, then along the second largest,
+    // and the upper corner. first and second are the offsets, in floats,
+    // of the middle two corners from the lower one.
+    struct tetrahedron {
+        size_t first;
+        size_t second;
+        float w[4];
+    };
+
+    tetrahedron select_tetrahedron(float tr, float tg, float tb, size_t r_step, size_t g_step, size_t b_step) {
+        // Rank the axes by decreasing fraction, ties going to r, then g.
+        // Which tetrahedron a pixel falls into is close to random, so this
+        // avoids branching on it.
+        int r_rank = (tr < tg) + (tr < tb);
+        int g_rank = (tg <= tr) + (tg < tb);
+        int b_rank = (tb <= tr) + (tb <= tg);
+
+        size_t step[3];
+        float t[3];
+        step[r_rank] = r_step;
+        step[g_rank] = g_step;
+        step[b_rank] = b_step;
+        t[r_rank] = tr;
+        t[g_rank] = tg;
+        t[b_rank] = tb;
+        return { step[0], step[0] + step[1], { 1 - t[0], t[0] - t[1], t[1] - t[2], t[2] } };
+    }
+
+#ifdef __AVX2__
+
+    // locate for eight packed pixels, with the same arithmetic so that
+    // both pick the same cell. base is each lower corner's offset in
+    // floats, for nodes stride floats apart.
+    struct lattice_position8 {
+        __m256i base;
+        __m256 tr, tg, tb;
+    };
+
+    lattice_position8 locate8(__m256i pixels, int grid, int stride) {
+        const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+        const __m256 cells = _mm256_set1_ps(static_cast<float>(grid - 1));
+        const __m256 full_scale = _mm256_set1_ps(255.0f);
+        const __m256i max_cell = _mm256_set1_epi32(grid - 2);
+        const __m256i grid_v = _mm256_set1_epi32(grid);
+
+        auto position = [&](__m256i channel, __m256i& cell) {
+            __m256 pos = _mm256_div_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(channel), cells), full_scale);
+            cell = _mm256_min_epi32(_mm256_cvttps_epi32(pos), max_cell);
+            return _mm256_sub_ps(pos, _mm256_cvtepi32_ps(cell));
+            };
+
+        lattice_position8 p;
+        __m256i r0, g0, b0;
+        p.tr = position(_mm256_and_si256(_mm256_srli_epi32(pixels, 16), byte_mask), r0);
+        p.tg = position(_mm256_and_si256(_mm256_srli_epi32(pixels, 8), byte_mask), g0);
+        p.tb = position(_mm256_and_si256(pixels, byte_mask), b0);
+        p.base = _mm256_mullo_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(
+            _mm256_mullo_epi32(r0, grid_v), g0), grid_v), b0), _mm256_set1_epi32(stride));
+        return p;
+    }
+
+    // select_tetrahedron for eight lanes, with the same tie breaking: the
+    // largest fraction's axis is stepped first and the smallest one's last
+    struct tetrahedron8 {
+        __m256i first;
+        __m256i second;
+        __m256 w[4];
+    };
+
+    tetrahedron8 select_tetrahedron8(__m256 tr, __m256 tg, __m256 tb, int r_stride, int g_stride, int b_stride) {
+        const __m256i r_step = _mm256_set1_epi32(r_stride);
+        const __m256i g_step = _mm256_set1_epi32(g_stride);
+        const __m256i b_step = _mm256_set1_epi32(b_stride);
+        const __m256i diagonal = _mm256_set1_epi32(r_stride + g_stride + b_stride);
+
+        tetrahedron8 t;
+        __m256 hi = _mm256_max_ps(_mm256_max_ps(tr, tg), tb);
+        __m256 lo = _mm256_min_ps(_mm256_min_ps(tr, tg), tb);
+        __m256 mid = _mm256_max_ps(_mm256_min_ps(tr, tg), _mm256_min_ps(_mm256_max_ps(tr, tg), tb));
+        t.w[0] = _mm256_sub_ps(_mm256_set1_ps(1.0f), hi);
+        t.w[1] = _mm256_sub_ps(hi, mid);
+        t.w[2] = _mm256_sub_ps(mid, lo);
+        t.w[3] = lo;
+
+        __m256i r_first = _mm256_castps_si256(_mm256_and_ps(
+            _mm256_cmp_ps(tr, tg, _CMP_GE_OQ), _mm256_cmp_ps(tr, tb, _CMP_GE_OQ)));
+        __m256i g_first = _mm256_castps_si256(_mm256_and_ps(
+            _mm256_cmp_ps(tg, tr, _CMP_GT_OQ), _mm256_cmp_ps(tg, tb, _CMP_GE_OQ)));
+        t.first = _mm256_blendv_epi8(_mm256_blendv_epi8(b_step, g_step, g_first), r_step, r_first);
+
+        __m256i r_last = _mm256_castps_si256(_mm256_and_ps(
+            _mm256_cmp_ps(tr, tg, _CMP_LT_OQ), _mm256_cmp_ps(tr, tb, _CMP_LT_OQ)));
+        __m256i g_last = _mm256_castps_si256(_mm256_and_ps(
+            _mm256_cmp_ps(tg, tr, _CMP_LE_OQ), _mm256_cmp_ps(tg, tb, _CMP_LT_OQ)));
+        __m256i last = _mm256_blendv_epi8(_mm256_blendv_epi8(b_step, g_step, g_last), r_step, r_last);
+        t.second = _mm256_sub_epi32(diagonal, last);
+        return t;
+    }
+
+#endif
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser::kernels Vectorized Row Kernels
+// -------------------------------------------------------------------------
+// Each is defined in a translation unit built for its instruction set and
+// only exists when simd_support.hpp says that unit was built; callers also
+// check the CPU before calling.
+namespace ser::kernels {
+
+    // color_lut::look_up_row for whole blocks of eight pixels. Returns the
+    // number of pixels done, a multiple of eight; the caller finishes the
+    // rest with the scalar path.
+    int interpolate_row_avx2(interpolation mode, const float* lut, int n, int grid,
+        const QRgb* pixels, int count, float* const* out_rows);
+    int interpolate_row_avx2(interpolation mode, const float* lut, int n, int grid,
+        const QRgb* pixels, int count, double* const* out_rows);
+
+    // reink_lut::look_up_row for whole blocks of eight pixels, over nodes
+    // of 4 floats. Returns the number of pixels done.
+    int reink_row_avx2(const float* nodes, int grid, const QRgb* pixels, int count, QRgb* out);
+
+}
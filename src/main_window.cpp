@@ -2,6 +2,8 @@
 #include "serigraph_widget.h"
 #include "serigraph.hpp"
 #include "palette_widget.hpp"
+#include "separation_file.hpp"
+#include "strip_pipeline.hpp"
 #include <QMenuBar>
 #include <QMenu>
 #include <QAction>
@@ -11,10 +13,32 @@
 #include <QDockWidget> 
 #include <QVBoxLayout> 
 #include <QPushButton> 
+#include <QProgressBar>
+#include <QStatusBar>
+#include <QFileInfo>
+#include <QTimer>
+#include <chrono>
+#include <memory>
 #include <tuple>
 
 namespace {
 
+    // Longest side of the reduced image the preview levels are shown on
+    constexpr int PREVIEW_SIZE = 1024;
+
+    // Index of the one entry in which two equally long palettes differ, or
+    // -1 if they differ in none or in several
+    int single_changed_entry(const std::vector<QColor>& before, const std::vector<QColor>& after) {
+        if (before.size() != after.size()) return -1;
+        int changed = -1;
+        for (size_t i = 0; i < after.size(); ++i) {
+            if (before[i] == after[i]) continue;
+            if (changed >= 0) return -1;
+            changed = static_cast<int>(i);
+        }
+        return changed;
+    }
+
 }
 
 ser::main_window::main_window(QWidget* parent)
@@ -23,12 +47,38 @@ ser::main_window::main_window(QWidget* parent)
     setCentralWidget(canvas_ = new serigraph_widget(this));
     create_docks();
     create_menus();
+
+    // One job at a time; a cancelled job winds down before the next starts
+    pool_.setMaxThreadCount(1);
+    progress_ = new QProgressBar(this);
+    progress_->setRange(0, 1000);
+    progress_->setMaximumWidth(200);
+    progress_->hide();
+    statusBar()->addPermanentWidget(progress_);
+
+    // Re-inking gets a pool of its own so it never waits behind a separation
+    reink_pool_.setMaxThreadCount(1);
+    reink_timer_ = new QTimer(this);
+    reink_timer_->setSingleShot(true);
+    reink_timer_->setInterval(16);
+    connect(reink_timer_, &QTimer::timeout, this, &ser::main_window::reink);
+    composite_timer_ = new QTimer(this);
+    composite_timer_->setSingleShot(true);
+    composite_timer_->setInterval(250);
+    connect(composite_timer_, &QTimer::timeout, this, &ser::main_window::composite_reink);
+
     setWindowTitle(tr("serigraph"));
     resize(1200, 800);
 }
 
 ser::main_window::~main_window()
 {
+    // The jobs post back to this window, so they must finish before it goes
+    job_stop_.request_stop();
+    reink_stop_.request_stop();
+    composite_stop_.request_stop();
+    pool_.waitForDone();
+    reink_pool_.waitForDone();
 }
 
 void ser::main_window::create_menus() {
@@ -39,6 +89,19 @@ void ser::main_window::create_menus() {
     connect(open_act, &QAction::triggered, this, &main_window::open_file);
     file_menu->addAction(open_act);
 
+    QAction* open_sep_act = new QAction(tr("Open Se&paration..."), this);
+    connect(open_sep_act, &QAction::triggered, this, &main_window::open_separation);
+    file_menu->addAction(open_sep_act);
+
+    QAction* save_sep_act = new QAction(tr("&Save Separation..."), this);
+    save_sep_act->setShortcut(QKeySequence::Save);
+    connect(save_sep_act, &QAction::triggered, this, &main_window::save_separation);
+    file_menu->addAction(save_sep_act);
+
+    QAction* large_act = new QAction(tr("Separate &Large Image..."), this);
+    connect(large_act, &QAction::triggered, this, &main_window::separate_large_image);
+    file_menu->addAction(large_act);
+
     file_menu->addSeparator();
 
     QAction* exit_act = new QAction(tr("E&xit"), this);
@@ -46,6 +109,12 @@ void ser::main_window::create_menus() {
     connect(exit_act, &QAction::triggered, this, &QWidget::close);
     file_menu->addAction(exit_act);
 
+    QMenu* separation_menu = menuBar()->addMenu(tr("&Separation"));
+    QAction* exact_act = separation_menu->addAction(tr("Solve Colors &Exactly"));
+    exact_act->setCheckable(true);
+    exact_act->setChecked(exact_colors_);
+    connect(exact_act, &QAction::toggled, this, [this](bool checked) { exact_colors_ = checked; });
+
     // Optional: View menu to toggle docks
     QMenu* view_menu = menuBar()->addMenu(tr("&View"));
     view_menu->addAction(tr("Toggle Source Palette"), [this](bool) {
@@ -97,7 +166,7 @@ void ser::main_window::create_docks() {
     target_palette_->set_colors({ Qt::white });
 
     connect(separate_button, &QPushButton::clicked, this, &ser::main_window::separate_layers);
-    connect(reink_button, &QPushButton::clicked, this, &ser::main_window::reink);
+    connect(reink_button, &QPushButton::clicked, this, &ser::main_window::request_reink);
     connect(source_palette_, &ser::palette_widget::color_added_requested, this, &ser::main_window::add_color_to_palettes);
 
     connect(source_palette_, &ser::palette_widget::color_delete_requested, this, [this](int index) {
@@ -105,6 +174,12 @@ void ser::main_window::create_docks() {
         target_palette_->remove_swatch_at(index);
         });
 
+    // A running separation is for a palette that no longer exists
+    connect(source_palette_, &ser::palette_widget::palette_changed, this, &ser::main_window::cancel_separation);
+
+    // Target edits, including drags in the color dialog, re-ink as they happen
+    connect(target_palette_, &ser::palette_widget::palette_changed, this, &ser::main_window::request_reink);
+
     connect(canvas_, &ser::serigraph_widget::source_pixel_clicked,
         this, &ser::main_window::add_color_to_palettes);
 }
@@ -121,24 +196,424 @@ void ser::main_window::open_file() {
             return;
         }
 
+        // A running separation is for the previous image; its result must not
+        // land on top of the new one
+        cancel_separation();
         canvas_->set_source_image(image.convertToFormat(QImage::Format_RGB32));
+
+        // The layers and the re-inked pane belong to the previous image
+        invalidate_reink();
+        layers_.reset();
+        table_frame_ = QImage();
+        reinked_palette_.clear();
+    }
+}
+
+void ser::main_window::open_separation() {
+    QString file_name = QFileDialog::getOpenFileName(this,
+        tr("Open Separation"), "", tr("Separations (*.serisep)"));
+    if (file_name.isEmpty()) return;
+
+    uint64_t generation;
+    job_control job = start_job(generation);
+    pool_.start([this, generation, job, file_name]() {
+        struct result {
+            ink_separation layers;
+            std::vector<QColor> palette;
+            std::vector<QColor> target_palette;
+            QImage separated;
+            QImage reinked;
+        };
+        auto res = std::make_shared<result>();
+
+        // The file holds no source image; the composite of the layers with
+        // their own inks stands in for it. Both composites are made tile by
+        // tile as the file is decoded.
+        if (auto file = separation_file::open(file_name)) {
+            if (read_separation(*file, res->layers, res->separated, res->reinked, job)) {
+                res->palette = file->palette();
+                res->target_palette = file->target_palette();
+            }
+        }
+        if (job.stop_requested()) return;
+
+        QMetaObject::invokeMethod(this, [this, generation, res, file_name]() {
+            if (generation != job_generation_) return;
+            progress_->hide();
+            if (res->layers.empty()) {
+                QMessageBox::information(this, tr("Serigraph"),
+                    tr("Cannot open %1.").arg(file_name));
+                return;
+            }
+            source_palette_->set_colors(res->palette);
+            target_palette_->set_colors(res->target_palette);
+            canvas_->set_source_image(res->separated);
+            canvas_->set_separated_image(res->separated);
+
+            // There is no LUT for the file's inks until the next separation;
+            // until then re-inking composites the layers
+            invalidate_reink();
+            lut_ = color_lut();
+            layers_ = std::make_shared<const ink_separation>(std::move(res->layers));
+            layers_palette_ = res->palette;
+            reinked_ = std::move(res->reinked);
+            table_frame_ = QImage();
+            reink_lut_ = reink_lut();
+            reinked_palette_ = res->target_palette;
+            canvas_->set_reinked_image(reinked_);
+            }, Qt::QueuedConnection);
+        });
+}
+
+void ser::main_window::save_separation() {
+    if (!layers_) {
+        QMessageBox::information(this, tr("Serigraph"), tr("There is no separation to save."));
+        return;
     }
+    QString file_name = QFileDialog::getSaveFileName(this,
+        tr("Save Separation"), "", tr("Separations (*.serisep)"));
+    if (file_name.isEmpty()) return;
+
+    // The layers are shared read-only, so saving needs no copy. It queues
+    // behind a running job rather than cancelling it.
+    auto target_palette = (reinked_palette_.size() == layers_->size()) ? reinked_palette_ : layers_palette_;
+    pool_.start([this, file_name, layers = layers_, palette = layers_palette_, target_palette]() {
+        bool saved = separation_file::write(file_name, *layers, palette, target_palette);
+        QMetaObject::invokeMethod(this, [this, saved, file_name]() {
+            if (!saved) {
+                QMessageBox::information(this, tr("Serigraph"),
+                    tr("Cannot save %1.").arg(file_name));
+                return;
+            }
+            statusBar()->showMessage(tr("Saved %1.").arg(file_name), 5000);
+            }, Qt::QueuedConnection);
+        });
+}
+
+void ser::main_window::separate_large_image() {
+    QString in_name = QFileDialog::getOpenFileName(this,
+        tr("Separate Large Image"), "", tr("Image Files (*.png *.tif *.tiff)"));
+    if (in_name.isEmpty()) return;
+    QString out_name = QFileDialog::getSaveFileName(this,
+        tr("Save Re-inked Image"), "", tr("Image Files (*.png *.tif *.tiff)"));
+    if (out_name.isEmpty()) return;
+
+    // The ink planes go beside the re-inked image, in the same format
+    QFileInfo out_info(out_name);
+    strip_settings settings;
+    settings.reinked_path = out_name;
+    settings.layer_pattern = out_info.path() + "/" + out_info.completeBaseName() + "_ink%1." + out_info.suffix();
+
+    // The file never enters memory whole, so it takes the place of the
+    // current job instead of the panes
+    auto palette = source_palette_->get_colors();
+    auto target_palette = to_latent_space(target_palette_->get_colors());
+    uint64_t generation;
+    job_control job = start_job(generation);
+
+    // A fully refined LUT for this palette is reused, anything else is
+    // baked. A palette that bakes to nothing fails like an unreadable file,
+    // which also retires the progress bar.
+    pool_.start([this, generation, job, in_name, palette, target_palette, settings, lut = lut_]() mutable {
+        auto files = job.step(0.0, 1.0);
+        if (lut.source_palette() != palette || !lut.is_refined()) {
+            lut.reset_palette(palette, job.step(0.0, 0.2));
+            files = job.step(0.2, 1.0);
+        }
+        int rows = lut.palette().empty() ? -1 : separate_file(in_name, lut, target_palette, settings, files);
+        if (job.stop_requested()) return;
+
+        QMetaObject::invokeMethod(this, [this, generation, rows, in_name]() {
+            if (generation != job_generation_) return;
+            progress_->hide();
+            if (rows < 0) {
+                QMessageBox::information(this, tr("Serigraph"),
+                    tr("Cannot separate %1.").arg(in_name));
+                return;
+            }
+            statusBar()->showMessage(tr("Separated %1 rows of %2.").arg(rows).arg(in_name), 5000);
+            }, Qt::QueuedConnection);
+        });
 }
 
 void ser::main_window::separate_layers() {
 
+    // Clicking Separate while a job runs restarts it with the current palette
     auto src = canvas_->src_image();
     auto palette = source_palette_->get_colors();
-    std::tie(layers_, lut_) = separate_image(src, palette);
-    auto separated_image = ink_layers_to_image(layers_, lut_.palette());
-    canvas_->set_separated_image(separated_image);
+    uint64_t generation;
+    job_control job = start_job(generation);
+
+    // The job works on a copy of the LUT, so a cancelled bake never touches lut_
+    auto target_palette = target_palette_->get_colors();
+    bool exact = exact_colors_;
+    pool_.start([this, generation, job, src, palette, target_palette, exact, lut = lut_]() mutable {
+        struct result {
+            color_lut lut;
+            ink_separation layers;
+            QImage separated;
+            reink_lut reink;
+            QImage reinked;
 
+            // Exact mode's colors and time for the final level, in ms, and
+            // how far its solutions are from the LUT, for the status bar
+            size_t exact_colors = 0;
+            double exact_ms = -1.0;
+            double exact_difference = 0.0;
+        };
+
+        // Flat art is separated and composited once per distinct color. The
+        // index is built once for all levels; an image with too many colors
+        // leaves it empty and goes pixel by pixel. The LUT work gets the
+        // rest of the progress bar.
+        color_index index(src, color_index::DEFAULT_MAX_COLORS, job.step(0.0, 0.05));
+        if (job.stop_requested()) return;
+        const job_control work = job.step(0.05, 1.0);
+
+        // In exact mode the final level is solved per color, through the
+        // solutions cached on disk for this palette
+        exact = exact && !index.empty();
+        exact_solution_cache solutions;
+        if (exact) solutions = exact_solution_cache(palette);
+
+        // Separates and composites with the LUT as it stands, then swaps
+        // everything in at once on the GUI thread. The coarse levels are
+        // only looked at, so they are worked out on a reduced copy of the
+        // image, without layers, and scaled up for display. The final post
+        // also retires the progress bar.
+        auto publish = [&](const job_control& step, bool final) {
+            auto res = std::make_shared<result>();
+            if (!final) {
+                QImage preview = src;
+                if (src.width() > PREVIEW_SIZE || src.height() > PREVIEW_SIZE) {
+                    preview = src.scaled(PREVIEW_SIZE, PREVIEW_SIZE, Qt::KeepAspectRatio, Qt::FastTransformation);
+                }
+                res->separated = separate_and_reink(preview, lut, lut.palette(), step.step(0.0, 0.8));
+                if (job.stop_requested()) return false;
+                res->reink = reink_lut(lut, target_palette);
+                res->reinked = reink_image(preview, res->reink, step.step(0.8, 1.0));
+                if (job.stop_requested()) return false;
+                if (preview.size() != src.size()) {
+                    res->separated = res->separated.scaled(src.size());
+                    res->reinked = res->reinked.scaled(src.size());
+                }
+            }
+            else {
+                if (index.empty()) {
+                    // One pass composites while it separates, instead of
+                    // reading every layer back
+                    res->layers = ink_separation(lut.palette().size(), src.width(), src.height(), ink_format::uint16);
+                    res->separated = separate_and_reink(src, lut, lut.palette(), step.step(0.0, 0.8), &res->layers);
+                }
+                else if (exact) {
+                    auto start = std::chrono::steady_clock::now();
+                    res->layers = separate_image(index, solutions, step.step(0.0, 0.6));
+                    if (job.stop_requested()) return false;
+                    res->exact_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    res->exact_colors = index.size();
+                    res->exact_difference = solutions.max_difference(lut, index.colors());
+                    solutions.save();
+                    res->separated = ink_layers_to_image(res->layers, index, lut.palette(), step.step(0.6, 0.8));
+                }
+                else {
+                    res->layers = separate_image(index, lut, step.step(0.0, 0.6));
+                    if (job.stop_requested()) return false;
+                    res->separated = ink_layers_to_image(res->layers, index, lut.palette(), step.step(0.6, 0.8));
+                }
+                if (job.stop_requested()) return false;
+                res->reink = reink_lut(lut, target_palette);
+                res->reinked = reink_image(src, res->reink, step.step(0.8, 1.0));
+                if (job.stop_requested()) return false;
+            }
+            res->lut = final ? std::move(lut) : lut;
+
+            QMetaObject::invokeMethod(this, [this, generation, res, final, palette, target_palette]() {
+                if (generation != job_generation_) return;
+                lut_ = std::move(res->lut);
+                if (final) {
+                    layers_ = std::make_shared<const ink_separation>(std::move(res->layers));
+                    layers_palette_ = palette;
+                }
+                else {
+                    layers_.reset();
+                    layers_palette_.clear();
+                }
+                canvas_->set_separated_image(res->separated);
+
+                // A live frame still rendering was made with the old LUT
+                invalidate_reink();
+                reinked_ = std::move(res->reinked);
+                table_frame_ = final ? reinked_ : QImage();
+                reink_lut_ = std::move(res->reink);
+                reinked_palette_ = target_palette;
+                canvas_->set_reinked_image(reinked_);
+                if (target_palette_->get_colors() != target_palette) request_reink();
+                else if (final) composite_timer_->start();
+                if (final) progress_->hide();
+                if (res->exact_ms >= 0.0) {
+                    statusBar()->showMessage(tr("Solved %1 colors exactly in %2 ms, at most %3 from the LUT.")
+                        .arg(res->exact_colors).arg(res->exact_ms, 0, 'f', 0).arg(res->exact_difference, 0, 'f', 4));
+                }
+                }, Qt::QueuedConnection);
+            return true;
+            };
+
+        // A single swatch edit since the last separation only re-solves the
+        // lattice nodes it affects, which needs no preview
+        if (lut.can_update_incrementally(palette)) {
+            if (lut.update_palette(palette, work.step(0.0, 0.6)) < 0) return;
+            publish(work.step(0.6, 1.0), true);
+            return;
+        }
+
+        // Otherwise put a 9x9x9 preview on screen first and refine it level
+        // by level, updating the panes each time
+        if (lut.reset_preview(palette, work.step(0.0, 0.05)) < 0) return;
+        if (!publish(work.step(0.05, 0.1), lut.is_refined())) return;
+        while (!lut.is_refined()) {
+            bool last = (2 * lut.grid_size() - 1 == color_lut::full_grid_size());
+            auto level = last ? work.step(0.3, 1.0) : work.step(0.1, 0.3);
+            if (lut.refine(level.step(0.0, 0.6)) < 0) return;
+            if (!publish(level.step(0.6, 1.0), lut.is_refined())) return;
+        }
+        });
+}
+
+ser::job_control ser::main_window::start_job(uint64_t& generation) {
+    cancel_separation();
+    generation = job_generation_;
+
+    // Progress arrives from worker threads and is forwarded to the GUI thread
+    job_control job{ job_stop_.get_token(), [this, generation](double fraction) {
+        QMetaObject::invokeMethod(this, [this, generation, fraction]() {
+            if (generation == job_generation_) {
+                progress_->setValue(static_cast<int>(fraction * progress_->maximum()));
+            }
+            }, Qt::QueuedConnection);
+        } };
+
+    progress_->setValue(0);
+    progress_->show();
+    return job;
+}
+
+void ser::main_window::cancel_separation() {
+    job_stop_.request_stop();
+    job_stop_ = std::stop_source();
+    ++job_generation_;
+    progress_->hide();
+}
+
+void ser::main_window::request_reink() {
+    // The timer is not restarted, so a steady stream of edits still renders
+    // once per frame instead of waiting for the stream to stop
+    if (!reink_timer_->isActive()) reink_timer_->start();
+}
+
+void ser::main_window::invalidate_reink() {
+    reink_stop_.request_stop();
+    reink_stop_ = std::stop_source();
+    composite_timer_->stop();
+    composite_stop_.request_stop();
+    composite_stop_ = std::stop_source();
+    ++reink_generation_;
 }
 
 void ser::main_window::reink() {
 
+    // Edits arriving while a frame renders are folded into a single one that
+    // starts when it is done
+    if (reink_running_) {
+        reink_pending_ = true;
+        return;
+    }
+    reink_running_ = true;
+
+    // A composite still on its way is for a palette being edited away
+    composite_timer_->stop();
+    composite_stop_.request_stop();
+    composite_stop_ = std::stop_source();
+
+    uint64_t generation = reink_generation_;
+    job_control job{ reink_stop_.get_token() };
     auto palette = target_palette_->get_colors();
-    auto reinked_image = ink_layers_to_image(layers_, palette);
-    canvas_->set_reinked_image(reinked_image);
 
-}
\ No newline at end of file
+    // The job works on copies; the layers are shared read-only and the image
+    // detaches on the first patched row
+    reink_pool_.start([this, generation, job, palette, src = canvas_->src_image(), lut = lut_,
+            layers = layers_, table = reink_lut_, before = reinked_palette_, reinked = table_frame_]() mutable {
+        struct result {
+            reink_lut reink;
+            QImage reinked;
+            bool from_table = false;
+        };
+        auto res = std::make_shared<result>();
+
+        // 1. A separation opened from a file has no LUT, so its layers are
+        // composited with the new inks
+        bool patched = false;
+        if (lut.palette().empty() && layers) {
+            reinked = ink_layers_to_image(*layers, palette, job);
+            patched = true;
+        }
+
+        // 2. After a single swatch edit only the nodes holding that ink are
+        // remixed, and only the tiles with colors in their cells looked up
+        // again. That patches a frame of the table, not a composite.
+        int changed = single_changed_entry(before, palette);
+        if (!patched && changed >= 0 && !reinked.isNull()) {
+            table.update_ink(lut, palette, changed);
+            patched = reink_tiles(reinked, src, table, job) >= 0;
+        }
+
+        // 3. Otherwise the whole image is looked up again. The re-inked color
+        // is a function of the source color alone, so a new target palette
+        // needs no pass over the ink layers.
+        if (!patched && !job.stop_requested()) {
+            table = reink_lut(lut, palette);
+            reinked = reink_image(src, table, job);
+        }
+        res->reink = std::move(table);
+        res->reinked = std::move(reinked);
+        res->from_table = !lut.palette().empty();
+
+        // 4. Posts back even when stopped, so that the next frame can start
+        bool stopped = job.stop_requested();
+        QMetaObject::invokeMethod(this, [this, generation, res, palette, stopped]() {
+            reink_running_ = false;
+            if (!stopped && generation == reink_generation_) {
+                reinked_ = std::move(res->reinked);
+                table_frame_ = res->from_table ? reinked_ : QImage();
+                reink_lut_ = std::move(res->reink);
+                reinked_palette_ = palette;
+                canvas_->set_reinked_image(reinked_);
+            }
+            if (reink_pending_) {
+                reink_pending_ = false;
+                reink();
+            }
+            else if (!lut_.palette().empty()) {
+                composite_timer_->start();
+            }
+            }, Qt::QueuedConnection);
+        });
+}
+
+void ser::main_window::composite_reink() {
+    if (reink_running_ || !layers_ || layers_->size() != reinked_palette_.size()) return;
+
+    // Runs behind any frame on the re-ink pool; the next frame stops it
+    uint64_t generation = reink_generation_;
+    job_control job{ composite_stop_.get_token() };
+    reink_pool_.start([this, generation, job, layers = layers_, palette = reinked_palette_]() {
+        QImage composite = ink_layers_to_image(*layers, palette, job);
+        if (job.stop_requested()) return;
+
+        QMetaObject::invokeMethod(this, [this, generation, composite, palette]() {
+            if (generation != reink_generation_ || reink_running_ || palette != reinked_palette_) return;
+            // The frame stays behind for the next edit to patch
+            reinked_ = composite;
+            canvas_->set_reinked_image(reinked_);
+            }, Qt::QueuedConnection);
+        });
+}
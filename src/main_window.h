@@ -1,8 +1,16 @@
 #pragma once
 
 #include <QMainWindow>
+#include <QThreadPool>
+#include <cstdint>
+#include <memory>
+#include <stop_token>
 #include "color_lut.hpp"
 #include "ink_layer.hpp"
+#include "reink_lut.hpp"
+
+class QProgressBar;
+class QTimer;
 
 namespace ser{
 
@@ -18,18 +26,70 @@ namespace ser{
 
     private slots:
         void open_file();
+        void separate_large_image();
+        void open_separation();
+        void save_separation();
 
     private:
         void create_docks(); // New helper to setup the side panels
         void create_menus();
         void add_color_to_palettes(const QColor& color);
         void separate_layers();
+        void cancel_separation();
+
+        // Cancels the running job and shows progress for a new one, whose
+        // generation it stores
+        job_control start_job(uint64_t& generation);
+
+        void request_reink();
         void reink();
+        void composite_reink();
+        void invalidate_reink();
 
         serigraph_widget* canvas_;
-        ink_separation layers_;
+        std::shared_ptr<const ink_separation> layers_;
+        std::vector<QColor> layers_palette_;
         color_lut lut_;
 
+        // Final separations solve each distinct color of the image exactly
+        // instead of going through the LUT, if it has few enough of them
+        bool exact_colors_ = false;
+
+        // What the re-inked pane shows and what it was made with, for delta
+        // re-inking. Only a full-size frame looked up in reink_lut_ can be
+        // patched, so the last one is kept in table_frame_ while the pane
+        // shows a layer composite; it is null after a preview.
+        QImage reinked_;
+        QImage table_frame_;
+        reink_lut reink_lut_;
+        std::vector<QColor> reinked_palette_;
+
+        // Re-inking follows target palette edits live. Requests are held to
+        // one per frame and coalesced while a render runs; renders run one at
+        // a time on their own pool, and a frame whose generation is out of
+        // date when it arrives is dropped.
+        QThreadPool reink_pool_;
+        QTimer* reink_timer_;
+        std::stop_source reink_stop_;
+        uint64_t reink_generation_ = 0;
+        bool reink_running_ = false;
+        bool reink_pending_ = false;
+
+        // Frames go through reink_lut_, which blends mixed node colors and
+        // so differs from compositing the layers by a few levels where the
+        // mix bends within a cell. Once edits settle the layers themselves
+        // are composited with the target palette and replace the frame.
+        QTimer* composite_timer_;
+        std::stop_source composite_stop_;
+
+        // Separation runs as a background job on its own pool. Each job gets
+        // a generation number; results and progress of a job that has since
+        // been cancelled or superseded are dropped on arrival.
+        QThreadPool pool_;
+        std::stop_source job_stop_;
+        uint64_t job_generation_ = 0;
+        QProgressBar* progress_;
+
         // New members for the palettes
         palette_widget* source_palette_;
         palette_widget* target_palette_;
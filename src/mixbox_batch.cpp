@@ -0,0 +1,70 @@
+#include "mixbox_batch.hpp"
+#include "mixbox_kernels.hpp"
+#include "simd_support.hpp"
+#include "third-party/mixbox.h"
+
+// -------------------------------------------------------------------------
+// ser:: Free Functions
+// -------------------------------------------------------------------------
+
+ser::simd_level ser::mixbox_simd_level() {
+#if SERIGRAPH_BUILD_AVX512
+    if (cpu_has_avx512()) return simd_level::avx512;
+#endif
+#if SERIGRAPH_BUILD_AVX2
+    if (cpu_has_avx2()) return simd_level::avx2;
+#endif
+    return simd_level::scalar;
+}
+
+void ser::mixbox_rgb_to_latent_row(const QRgb* pixels, int count, float* const* latent) {
+    int x = 0;
+    switch (mixbox_simd_level()) {
+#if SERIGRAPH_BUILD_AVX512
+    case simd_level::avx512:
+        x = kernels::mixbox_rgb_to_latent_avx512(pixels, count, latent);
+        break;
+#endif
+#if SERIGRAPH_BUILD_AVX2
+    case simd_level::avx2:
+        x = kernels::mixbox_rgb_to_latent_avx2(pixels, count, latent);
+        break;
+#endif
+    default:
+        break;
+    }
+    for (; x < count; ++x) {
+        mixbox_latent z;
+        mixbox_rgb_to_latent(qRed(pixels[x]), qGreen(pixels[x]), qBlue(pixels[x]), z);
+        for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+            latent[d][x] = z[d];
+        }
+    }
+}
+
+void ser::mixbox_latent_to_rgb_row(const float* const* latent, int count, QRgb* pixels) {
+    int x = 0;
+    switch (mixbox_simd_level()) {
+#if SERIGRAPH_BUILD_AVX512
+    case simd_level::avx512:
+        x = kernels::mixbox_latent_to_rgb_avx512(latent, count, pixels);
+        break;
+#endif
+#if SERIGRAPH_BUILD_AVX2
+    case simd_level::avx2:
+        x = kernels::mixbox_latent_to_rgb_avx2(latent, count, pixels);
+        break;
+#endif
+    default:
+        break;
+    }
+    for (; x < count; ++x) {
+        mixbox_latent z;
+        for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+            z[d] = latent[d][x];
+        }
+        unsigned char r, g, b;
+        mixbox_latent_to_rgb(z, &r, &g, &b);
+        pixels[x] = qRgb(r, g, b);
+    }
+}
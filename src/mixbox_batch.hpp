@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QColor>
+
+namespace ser {
+
+    // Instruction set the batched conversions below use on this CPU
+    enum class simd_level {
+        scalar,
+        avx2,
+        avx512
+    };
+
+    simd_level mixbox_simd_level();
+
+    // Mixbox conversions over spans of colors, 16 at a time with AVX-512, 8
+    // with AVX2 and one by one through the vendored functions otherwise,
+    // picked at run time among the kernels the build has.
+    // Latent colors are passed as MIXBOX_LATENT_SIZE rows, component d of
+    // color x at latent[d][x]. The vector paths follow the reference
+    // arithmetic step by step and agree with it to float rounding, well
+    // within 1/255.
+    void mixbox_rgb_to_latent_row(const QRgb* pixels, int count, float* const* latent);
+    void mixbox_latent_to_rgb_row(const float* const* latent, int count, QRgb* pixels);
+
+}
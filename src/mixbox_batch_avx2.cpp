@@ -0,0 +1,57 @@
+#include "mixbox_kernels.hpp"
+
+#include <immintrin.h>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+// This unit alone is built with AVX2 and FMA enabled.
+namespace {
+
+    // The few operations the kernels need, for either vector width
+    struct avx2 {
+        using vf = __m256;
+        using vi = __m256i;
+        static constexpr int width = 8;
+
+        static vf set1(float v) { return _mm256_set1_ps(v); }
+        static vf load(const float* p) { return _mm256_loadu_ps(p); }
+        static void store(float* p, vf v) { _mm256_storeu_ps(p, v); }
+        static vf add(vf a, vf b) { return _mm256_add_ps(a, b); }
+        static vf sub(vf a, vf b) { return _mm256_sub_ps(a, b); }
+        static vf mul(vf a, vf b) { return _mm256_mul_ps(a, b); }
+        static vf fmadd(vf a, vf b, vf c) { return _mm256_fmadd_ps(a, b, c); }
+        static vf clamp01(vf v) { return _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), set1(1.0f)); }
+        static vf to_float(vi v) { return _mm256_cvtepi32_ps(v); }
+        static vi truncate(vf v) { return _mm256_cvttps_epi32(v); }
+
+        static vi set1i(int v) { return _mm256_set1_epi32(v); }
+        static vi loadi(const QRgb* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static void storei(QRgb* p, vi v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+        static vi addi(vi a, vi b) { return _mm256_add_epi32(a, b); }
+        static vi muli(vi a, vi b) { return _mm256_mullo_epi32(a, b); }
+        static vi andi(vi a, vi b) { return _mm256_and_si256(a, b); }
+        static vi ori(vi a, vi b) { return _mm256_or_si256(a, b); }
+        template <int bits> static vi srli(vi v) { return _mm256_srli_epi32(v, bits); }
+        template <int bits> static vi slli(vi v) { return _mm256_slli_epi32(v, bits); }
+
+        // Four bytes from base + offset for each lane
+        static vi gather_bytes(const unsigned char* base, vi offset) {
+            return _mm256_i32gather_epi32(reinterpret_cast<const int*>(base), offset, 1);
+        }
+    };
+
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser::kernels Free Functions
+// -------------------------------------------------------------------------
+
+int ser::kernels::mixbox_rgb_to_latent_avx2(const QRgb* pixels, int count, float* const* latent) {
+    return rgb_to_latent_kernel<avx2>(pixels, count, latent);
+}
+
+int ser::kernels::mixbox_latent_to_rgb_avx2(const float* const* latent, int count, QRgb* pixels) {
+    return latent_to_rgb_kernel<avx2>(latent, count, pixels);
+}
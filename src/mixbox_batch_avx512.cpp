@@ -0,0 +1,56 @@
+#include "mixbox_kernels.hpp"
+
+#include <immintrin.h>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+// This unit alone is built with AVX-512F enabled.
+namespace {
+
+    // The operations of the AVX2 traits in mixbox_batch_avx2.cpp, 16 wide
+    struct avx512 {
+        using vf = __m512;
+        using vi = __m512i;
+        static constexpr int width = 16;
+
+        static vf set1(float v) { return _mm512_set1_ps(v); }
+        static vf load(const float* p) { return _mm512_loadu_ps(p); }
+        static void store(float* p, vf v) { _mm512_storeu_ps(p, v); }
+        static vf add(vf a, vf b) { return _mm512_add_ps(a, b); }
+        static vf sub(vf a, vf b) { return _mm512_sub_ps(a, b); }
+        static vf mul(vf a, vf b) { return _mm512_mul_ps(a, b); }
+        static vf fmadd(vf a, vf b, vf c) { return _mm512_fmadd_ps(a, b, c); }
+        static vf clamp01(vf v) { return _mm512_min_ps(_mm512_max_ps(v, _mm512_setzero_ps()), set1(1.0f)); }
+        static vf to_float(vi v) { return _mm512_cvtepi32_ps(v); }
+        static vi truncate(vf v) { return _mm512_cvttps_epi32(v); }
+
+        static vi set1i(int v) { return _mm512_set1_epi32(v); }
+        static vi loadi(const QRgb* p) { return _mm512_loadu_si512(p); }
+        static void storei(QRgb* p, vi v) { _mm512_storeu_si512(p, v); }
+        static vi addi(vi a, vi b) { return _mm512_add_epi32(a, b); }
+        static vi muli(vi a, vi b) { return _mm512_mullo_epi32(a, b); }
+        static vi andi(vi a, vi b) { return _mm512_and_si512(a, b); }
+        static vi ori(vi a, vi b) { return _mm512_or_si512(a, b); }
+        template <int bits> static vi srli(vi v) { return _mm512_srli_epi32(v, bits); }
+        template <int bits> static vi slli(vi v) { return _mm512_slli_epi32(v, bits); }
+
+        static vi gather_bytes(const unsigned char* base, vi offset) {
+            return _mm512_i32gather_epi32(offset, base, 1);
+        }
+    };
+
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser::kernels Free Functions
+// -------------------------------------------------------------------------
+
+int ser::kernels::mixbox_rgb_to_latent_avx512(const QRgb* pixels, int count, float* const* latent) {
+    return rgb_to_latent_kernel<avx512>(pixels, count, latent);
+}
+
+int ser::kernels::mixbox_latent_to_rgb_avx512(const float* const* latent, int count, QRgb* pixels) {
+    return latent_to_rgb_kernel<avx512>(latent, count, pixels);
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "third-party/mixbox.h"
+#include <QColor>
+
+// -------------------------------------------------------------------------
+// Mixbox Kernel Templates (Anonymous Namespace)
+// -------------------------------------------------------------------------
+// Written once against a small vector traits type V (set1, load, fmadd,
+// gather_bytes, ...) that each kernel unit defines for its instruction
+// set. Internal linkage, as in lut_kernels.hpp, keeps the units' builds
+// of these apart.
+namespace {
+
+    // Weights of the 20 cubic terms of mixbox's eval_polynomial for r, g
+    // and b, in the reference's order
+    constexpr float POLYNOMIAL[20][3] = {
+        { +0.07717053f, +0.02826978f, +0.24832992f },
+        { +0.95912302f, +0.80256528f, +0.03561839f },
+        { +0.74683774f, +0.04868586f, +0.00000000f },
+        { +0.99518138f, +0.99978149f, +0.99704802f },
+        { +0.04819146f, +0.83363781f, +0.32515377f },
+        { -0.68146950f, +1.46107803f, +1.06980936f },
+        { +0.27058419f, -0.15324870f, +1.98735057f },
+        { +0.80478189f, +0.67093710f, +0.18424500f },
+        { -0.35031003f, +1.37855826f, +3.68865000f },
+        { +1.05128046f, +1.97815239f, +2.82989073f },
+        { +3.21607125f, +0.81270228f, +1.03384539f },
+        { +2.78893374f, +0.41565549f, -0.04487295f },
+        { +3.02162577f, +2.55374103f, +0.32766114f },
+        { +2.95124691f, +2.81201112f, +1.17578442f },
+        { +2.82677043f, +0.79933038f, +1.81715262f },
+        { +2.99691099f, +1.22593053f, +1.80653661f },
+        { +1.87394106f, +2.05027182f, -0.29835996f },
+        { +2.56609566f, +7.03428198f, +0.62575374f },
+        { +4.08329484f, -1.40408358f, +2.14995522f },
+        { +6.00078678f, +2.55552042f, +1.90739502f }
+    };
+
+    // Byte offsets of the 8 corners of a table cell from its entry, in the
+    // reference's order: x fastest, then y, then z
+    constexpr int CORNERS[8] = { 192, 195, 384, 387, 12480, 12483, 12672, 12675 };
+
+    // eval_polynomial across the lanes, summing the terms in the same order
+    template <typename V>
+    void eval_polynomial(typename V::vf c0, typename V::vf c1, typename V::vf c2, typename V::vf c3,
+            typename V::vf (&rgb)[3]) {
+        using vf = typename V::vf;
+        const vf c00 = V::mul(c0, c0);
+        const vf c11 = V::mul(c1, c1);
+        const vf c22 = V::mul(c2, c2);
+        const vf c33 = V::mul(c3, c3);
+        const vf c01 = V::mul(c0, c1);
+        const vf c02 = V::mul(c0, c2);
+        const vf c12 = V::mul(c1, c2);
+        const vf terms[20] = {
+            V::mul(c0, c00), V::mul(c1, c11), V::mul(c2, c22), V::mul(c3, c33),
+            V::mul(c00, c1), V::mul(c01, c1), V::mul(c00, c2), V::mul(c02, c2),
+            V::mul(c00, c3), V::mul(c0, c33), V::mul(c11, c2), V::mul(c1, c22),
+            V::mul(c11, c3), V::mul(c1, c33), V::mul(c22, c3), V::mul(c2, c33),
+            V::mul(c01, c2), V::mul(c01, c3), V::mul(c02, c3), V::mul(c12, c3)
+        };
+        for (int c = 0; c < 3; ++c) {
+            vf sum = V::set1(0.0f);
+            for (int t = 0; t < 20; ++t) {
+                sum = V::fmadd(V::set1(POLYNOMIAL[t][c]), terms[t], sum);
+            }
+            rgb[c] = sum;
+        }
+    }
+
+    // float_rgb_to_latent for V::width pixels at a time. Each table corner
+    // is one 32-bit gather holding the 3 pigment bytes in its upper three;
+    // it starts a byte early so the last corner of the table never reads
+    // past its end. Returns the number of pixels done.
+    template <typename V>
+    int rgb_to_latent_kernel(const QRgb* pixels, int count, float* const* latent) {
+        using vf = typename V::vf;
+        using vi = typename V::vi;
+        const unsigned char* lut = mixbox_lut_data();
+        const vi byte_mask = V::set1i(0xFF);
+        const vf to_unit = V::set1(1.0f / 255.0f);
+        const vf one = V::set1(1.0f);
+
+        int x = 0;
+        for (; x + V::width <= count; x += V::width) {
+            vi px = V::loadi(pixels + x);
+            vf rgb[3] = {
+                V::clamp01(V::mul(V::to_float(V::andi(V::template srli<16>(px), byte_mask)), to_unit)),
+                V::clamp01(V::mul(V::to_float(V::andi(V::template srli<8>(px), byte_mask)), to_unit)),
+                V::clamp01(V::mul(V::to_float(V::andi(px, byte_mask)), to_unit))
+            };
+
+            vf t[3];
+            vi cell[3];
+            for (int c = 0; c < 3; ++c) {
+                vf pos = V::mul(rgb[c], V::set1(63.0f));
+                cell[c] = V::truncate(pos);
+                t[c] = V::sub(pos, V::to_float(cell[c]));
+            }
+            vi entry = V::andi(V::addi(V::addi(cell[0], V::template slli<6>(cell[1])), V::template slli<12>(cell[2])),
+                V::set1i(0x3FFFF));
+            entry = V::muli(entry, V::set1i(3));
+
+            vf sums[3] = { V::set1(0.0f), V::set1(0.0f), V::set1(0.0f) };
+            for (int corner = 0; corner < 8; ++corner) {
+                vf w = V::mul(V::mul(
+                    (corner & 1) ? t[0] : V::sub(one, t[0]),
+                    (corner & 2) ? t[1] : V::sub(one, t[1])),
+                    (corner & 4) ? t[2] : V::sub(one, t[2]));
+                vi bytes = V::gather_bytes(lut, V::addi(entry, V::set1i(CORNERS[corner] - 1)));
+                sums[0] = V::fmadd(w, V::to_float(V::andi(V::template srli<8>(bytes), byte_mask)), sums[0]);
+                sums[1] = V::fmadd(w, V::to_float(V::andi(V::template srli<16>(bytes), byte_mask)), sums[1]);
+                sums[2] = V::fmadd(w, V::to_float(V::template srli<24>(bytes)), sums[2]);
+            }
+
+            vf c[4];
+            for (int d = 0; d < 3; ++d) {
+                c[d] = V::mul(sums[d], to_unit);
+            }
+            c[3] = V::sub(one, V::add(V::add(c[0], c[1]), c[2]));
+
+            vf mix[3];
+            eval_polynomial<V>(c[0], c[1], c[2], c[3], mix);
+            for (int d = 0; d < 4; ++d) {
+                V::store(latent[d] + x, c[d]);
+            }
+            for (int d = 0; d < 3; ++d) {
+                V::store(latent[4 + d] + x, V::sub(rgb[d], mix[d]));
+            }
+        }
+        return x;
+    }
+
+    // latent_to_rgb for V::width colors at a time, packed into QRgb
+    template <typename V>
+    int latent_to_rgb_kernel(const float* const* latent, int count, QRgb* pixels) {
+        using vf = typename V::vf;
+        using vi = typename V::vi;
+        const vf full_scale = V::set1(255.0f);
+        const vf half = V::set1(0.5f);
+
+        int x = 0;
+        for (; x + V::width <= count; x += V::width) {
+            vf rgb[3];
+            eval_polynomial<V>(V::load(latent[0] + x), V::load(latent[1] + x), V::load(latent[2] + x),
+                V::load(latent[3] + x), rgb);
+
+            vi channel[3];
+            for (int c = 0; c < 3; ++c) {
+                vf v = V::clamp01(V::add(rgb[c], V::load(latent[4 + c] + x)));
+                channel[c] = V::truncate(V::add(V::mul(v, full_scale), half));
+            }
+            vi packed = V::ori(V::ori(V::set1i(static_cast<int>(0xFF000000)), V::template slli<16>(channel[0])),
+                V::ori(V::template slli<8>(channel[1]), channel[2]));
+            V::storei(pixels + x, packed);
+        }
+        return x;
+    }
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser::kernels Vectorized Mixbox Conversions
+// -------------------------------------------------------------------------
+// mixbox_batch.hpp's row conversions for whole blocks of 8 or 16 colors.
+// Each returns the number of colors done; the caller finishes the rest
+// one by one. They exist only in builds that define SERIGRAPH_BUILD_AVX2
+// or SERIGRAPH_BUILD_AVX512 (simd_support.hpp).
+namespace ser::kernels {
+
+    int mixbox_rgb_to_latent_avx2(const QRgb* pixels, int count, float* const* latent);
+    int mixbox_latent_to_rgb_avx2(const float* const* latent, int count, QRgb* pixels);
+    int mixbox_rgb_to_latent_avx512(const QRgb* pixels, int count, float* const* latent);
+    int mixbox_latent_to_rgb_avx512(const float* const* latent, int count, QRgb* pixels);
+
+}
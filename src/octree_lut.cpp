@@ -0,0 +1,472 @@
+#include "octree_lut.hpp"
+#include "qp_solver.hpp"
+#include "third-party/mixbox.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <execution>
+#include <numeric>
+#include <unordered_map>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+namespace {
+
+    // Cells per axis at the root level, i.e. a 9x9x9 starting lattice
+    constexpr int ROOT_CELLS = 8;
+
+    // Deepest level accepted; 1024 fine cells per axis
+    constexpr int MAX_DEPTH = 6;
+
+    // Marks a leaf's entry in the cell array
+    constexpr uint32_t LEAF = 0x80000000u;
+
+    using position = std::array<int, 3>;
+
+    // Vertices are addressed on a lattice one level finer than the deepest
+    // cells, ROOT_CELLS << (max_depth + 1) per axis, so that those cells can
+    // still be probed at their midpoints. Each coordinate takes 16 bits.
+    uint64_t vertex_key(const position& p) {
+        return static_cast<uint64_t>(p[0]) | (static_cast<uint64_t>(p[1]) << 16) | (static_cast<uint64_t>(p[2]) << 32);
+    }
+
+    position key_position(uint64_t key) {
+        return { static_cast<int>(key & 0xFFFF), static_cast<int>((key >> 16) & 0xFFFF), static_cast<int>(key >> 32) };
+    }
+
+    ser::latent_space_color vertex_target(uint64_t key, int fine_cells) {
+        position p = key_position(key);
+        float scale = 1.0f / fine_cells;
+        mixbox_latent latent_arr;
+        mixbox_float_rgb_to_latent(p[0] * scale, p[1] * scale, p[2] * scale, latent_arr);
+        ser::latent_space_color target;
+        std::copy(std::begin(latent_arr), std::end(latent_arr), target.begin());
+        return target;
+    }
+
+    // Trilinear weight of corner (bit 2 = r, bit 1 = g, bit 0 = b) at t
+    float corner_weight(int corner, float tr, float tg, float tb) {
+        return ((corner & 4) ? tr : 1.0f - tr) *
+            ((corner & 2) ? tg : 1.0f - tg) *
+            ((corner & 1) ? tb : 1.0f - tb);
+    }
+
+    bool outside(const position& p, int fine_cells) {
+        return std::ranges::any_of(p, [&](int x) { return x < 0 || x >= fine_cells; });
+    }
+
+    // Builds the tree with every cell's position, depth and corners, and
+    // every point solved along the way, probes included, with its exact
+    // coefficients. Positions are in fine units.
+    class tree_builder {
+    public:
+
+        struct cell {
+            uint32_t first_child; // 0 for leaves; the root cells never appear as children
+            uint32_t corners[8];
+        };
+
+        std::vector<cell> cells;
+        std::vector<position> origins;
+        std::vector<uint8_t> depths;
+        std::unordered_map<uint64_t, uint32_t> vertex_ids;
+        std::vector<uint64_t> vertex_keys;
+        std::vector<float> values; // n coefficients per vertex
+        const int n;
+        const int fine_cells;
+
+        tree_builder(const std::vector<ser::latent_space_color>& palette, int max_depth) :
+                n(static_cast<int>(palette.size())),
+                fine_cells(ROOT_CELLS << (max_depth + 1)),
+                solver_(palette, ser::color_lut::lambda()) {
+        }
+
+        int size(uint32_t c) const {
+            return (fine_cells / ROOT_CELLS) >> depths[c];
+        }
+
+        bool is_leaf(uint32_t c) const {
+            return cells[c].first_child == 0;
+        }
+
+        // Registers a point to be solved by the next solve_pending
+        uint32_t vertex(const position& p) {
+            auto [it, inserted] = vertex_ids.try_emplace(vertex_key(p), static_cast<uint32_t>(vertex_keys.size()));
+            if (inserted) vertex_keys.push_back(it->first);
+            return it->second;
+        }
+
+        void solve_pending() {
+            size_t solved = values.size() / n;
+            values.resize(vertex_keys.size() * n);
+            std::vector<size_t> pending(vertex_keys.size() - solved);
+            std::iota(pending.begin(), pending.end(), solved);
+            std::for_each(std::execution::par, pending.begin(), pending.end(), [&](size_t v) {
+                ser::coefficients k(n);
+                solver_.solve(vertex_target(vertex_keys[v], fine_cells), k);
+                std::copy(k.begin(), k.end(), values.begin() + v * n);
+                });
+        }
+
+        void add_cell(const position& o, int depth) {
+            const int s = (fine_cells / ROOT_CELLS) >> depth;
+            cell c{ 0, {} };
+            for (int corner = 0; corner < 8; ++corner) {
+                c.corners[corner] = vertex({
+                    o[0] + ((corner >> 2) & 1) * s,
+                    o[1] + ((corner >> 1) & 1) * s,
+                    o[2] + (corner & 1) * s });
+            }
+            cells.push_back(c);
+            origins.push_back(o);
+            depths.push_back(static_cast<uint8_t>(depth));
+        }
+
+        void split(uint32_t c) {
+            const uint32_t first = static_cast<uint32_t>(cells.size());
+            const int half = size(c) / 2;
+            const position o = origins[c];
+            for (int child = 0; child < 8; ++child) {
+                add_cell({ o[0] + ((child >> 2) & 1) * half, o[1] + ((child >> 1) & 1) * half,
+                    o[2] + (child & 1) * half }, depths[c] + 1);
+            }
+            cells[c].first_child = first;
+        }
+
+        // The cell holding the fine unit cell at p, at depth or the leaf above it
+        uint32_t find(const position& p, int depth) const {
+            int s = fine_cells / ROOT_CELLS;
+            uint32_t c = static_cast<uint32_t>(((p[0] / s) * ROOT_CELLS + p[1] / s) * ROOT_CELLS + p[2] / s);
+            while (!is_leaf(c) && depths[c] < depth) {
+                s /= 2;
+                const position& o = origins[c];
+                int child = ((p[0] - o[0] >= s) << 2) | ((p[1] - o[1] >= s) << 1) | (p[2] - o[2] >= s);
+                c = cells[c].first_child + child;
+            }
+            return c;
+        }
+
+        // Trilinear interpolation of cell c's corners at p, from values
+        void interpolate(uint32_t c, const position& p, float* k) const {
+            const float s = static_cast<float>(size(c));
+            const position& o = origins[c];
+            float tr = (p[0] - o[0]) / s;
+            float tg = (p[1] - o[1]) / s;
+            float tb = (p[2] - o[2]) / s;
+            std::fill(k, k + n, 0.0f);
+            for (int corner = 0; corner < 8; ++corner) {
+                float w = corner_weight(corner, tr, tg, tb);
+                if (w == 0.0f) continue;
+                const float* v = values.data() + static_cast<size_t>(cells[c].corners[corner]) * n;
+                for (int i = 0; i < n; ++i) {
+                    k[i] += w * v[i];
+                }
+            }
+        }
+
+        // The 19 midpoints of a cell: center, face centers, edge midpoints
+        template <typename F>
+        void for_each_midpoint(uint32_t c, F&& f) const {
+            const int half = size(c) / 2;
+            const position& o = origins[c];
+            for (int p = 0; p < 27; ++p) {
+                position q = { p / 9, p / 3 % 3, p % 3 };
+                if (q[0] != 1 && q[1] != 1 && q[2] != 1) continue;
+                f(position{ o[0] + q[0] * half, o[1] + q[1] * half, o[2] + q[2] * half });
+            }
+        }
+
+        void register_probes(uint32_t c) {
+            for_each_midpoint(c, [&](const position& p) { vertex(p); });
+        }
+
+        // Largest deviation of the cell's interpolation at its midpoints
+        double probe_error(uint32_t c) const {
+            std::vector<float> k(n);
+            double error = 0.0;
+            for_each_midpoint(c, [&](const position& p) {
+                interpolate(c, p, k.data());
+                const float* exact = values.data() + static_cast<size_t>(vertex_ids.at(vertex_key(p))) * n;
+                for (int i = 0; i < n; ++i) {
+                    error = std::max(error, static_cast<double>(std::abs(exact[i] - k[i])));
+                }
+                });
+            return error;
+        }
+
+        // Splits leaves until no two touching leaves, across a face, an edge
+        // or a corner, differ by more than one level. Deepest leaves go
+        // first: each needs the 26 neighbours of its parent to exist at the
+        // parent's depth, and the leaves split for that are no deeper than
+        // the parent, so they are checked in a later pass.
+        void balance(int max_depth) {
+            for (int depth = max_depth; depth >= 2; --depth) {
+                std::vector<uint32_t> leaves;
+                for (uint32_t c = 0; c < cells.size(); ++c) {
+                    if (is_leaf(c) && depths[c] == depth) leaves.push_back(c);
+                }
+                for (uint32_t c : leaves) {
+                    const int parent_size = size(c) * 2;
+                    position o = origins[c];
+                    for (int& x : o) {
+                        x -= x % parent_size;
+                    }
+                    for (int d = 0; d < 27; ++d) {
+                        if (d == 13) continue;
+                        position p = { o[0] + (d / 9 - 1) * parent_size, o[1] + (d / 3 % 3 - 1) * parent_size,
+                            o[2] + (d % 3 - 1) * parent_size };
+                        if (outside(p, fine_cells)) continue;
+
+                        uint32_t neighbour;
+                        while (depths[neighbour = find(p, depth - 1)] < depth - 1) {
+                            split(neighbour);
+                        }
+                    }
+                }
+            }
+            solve_pending();
+        }
+
+        // Gives each leaf corner that lies on a face or edge of a coarser
+        // leaf that leaf's interpolated value there. A leaf's corner is never
+        // pinned to a leaf as small as the leaf itself, so pinning to the
+        // coarsest leaves first leaves each leaf's corners final before they
+        // are read. Returns the number of vertices pinned.
+        int pin_hanging(int max_depth) {
+            std::vector<char> used(vertex_keys.size(), 0);
+            for (uint32_t c = 0; c < cells.size(); ++c) {
+                if (!is_leaf(c)) continue;
+                for (uint32_t v : cells[c].corners) {
+                    used[v] = 1;
+                }
+            }
+
+            // 1. The coarsest leaf around each vertex that does not have it
+            // as a corner
+            struct pin {
+                uint32_t vertex;
+                uint32_t leaf;
+            };
+            std::vector<pin> pins;
+            for (uint32_t v = 0; v < vertex_keys.size(); ++v) {
+                if (!used[v]) continue;
+
+                const position p = key_position(vertex_keys[v]);
+                int best_size = 0;
+                uint32_t best = 0;
+                for (int d = 0; d < 8; ++d) {
+                    position around = { p[0] - ((d >> 2) & 1), p[1] - ((d >> 1) & 1), p[2] - (d & 1) };
+                    if (outside(around, fine_cells)) continue;
+
+                    uint32_t leaf = find(around, max_depth);
+                    const int s = size(leaf);
+                    const position& o = origins[leaf];
+                    bool corner = true;
+                    for (int axis = 0; axis < 3; ++axis) {
+                        corner = corner && (p[axis] == o[axis] || p[axis] == o[axis] + s);
+                    }
+                    if (!corner && s > best_size) {
+                        best_size = s;
+                        best = leaf;
+                    }
+                }
+                if (best_size > 0) pins.push_back({ v, best });
+            }
+
+            // 2. Coarsest leaves first
+            std::stable_sort(pins.begin(), pins.end(), [&](const pin& a, const pin& b) {
+                return size(a.leaf) > size(b.leaf);
+                });
+            std::vector<float> k(n);
+            for (const pin& p : pins) {
+                interpolate(p.leaf, key_position(vertex_keys[p.vertex]), k.data());
+                std::copy(k.begin(), k.end(), values.begin() + static_cast<size_t>(p.vertex) * n);
+            }
+            return static_cast<int>(pins.size());
+        }
+
+    private:
+
+        const ser::qp_solver solver_;
+    };
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser::octree_lut Implementation
+// -------------------------------------------------------------------------
+
+ser::octree_lut::octree_lut(const std::vector<QColor>& palette, double tolerance, int max_depth) {
+    palette_ = ser::to_latent_space(palette);
+    const int n = static_cast<int>(palette_.size());
+    if (n == 0) return;
+
+    max_depth = std::clamp(max_depth, 0, MAX_DEPTH);
+    tree_builder tree(palette_, max_depth);
+
+    // 1. Root lattice
+    const int root_size = tree.fine_cells / ROOT_CELLS;
+    for (int r = 0; r < ROOT_CELLS; ++r) {
+        for (int g = 0; g < ROOT_CELLS; ++g) {
+            for (int b = 0; b < ROOT_CELLS; ++b) {
+                tree.add_cell({ r * root_size, g * root_size, b * root_size }, 0);
+            }
+        }
+    }
+
+    // 2. Probe each cell of the current level at its midpoints and split it
+    // if trilinear interpolation of its corners misses the exact solution at
+    // any of them by more than the tolerance. The probes are exactly the
+    // corners its children need, so no probe of a split cell is wasted.
+    std::vector<uint32_t> level(tree.cells.size());
+    std::iota(level.begin(), level.end(), 0);
+    for (int depth = 0; depth < max_depth && !level.empty(); ++depth) {
+        for (uint32_t c : level) {
+            tree.register_probes(c);
+        }
+        tree.solve_pending();
+
+        std::vector<uint32_t> next_level;
+        for (uint32_t c : level) {
+            if (tree.probe_error(c) <= tolerance) continue;
+            uint32_t first = static_cast<uint32_t>(tree.cells.size());
+            tree.split(c);
+            for (uint32_t child = first; child < first + 8; ++child) {
+                next_level.push_back(child);
+            }
+        }
+        level = std::move(next_level);
+    }
+    tree.solve_pending();
+
+    // 3. Balance the tree and pin the hanging vertices. The exact solutions
+    // are kept aside for the error statistic.
+    tree.balance(max_depth);
+    const std::vector<float> exact = tree.values;
+    stats_.hanging = tree.pin_hanging(max_depth);
+
+    // 4. Pack the cells, keeping only the vertices some leaf refers to;
+    // probes of unsplit cells are dropped
+    std::vector<uint32_t> remap(tree.vertex_keys.size(), UINT32_MAX);
+    uint32_t kept = 0;
+    cells_.resize(tree.cells.size());
+    for (uint32_t c = 0; c < tree.cells.size(); ++c) {
+        if (!tree.is_leaf(c)) {
+            cells_[c] = tree.cells[c].first_child;
+            continue;
+        }
+        cells_[c] = LEAF | static_cast<uint32_t>(corners_.size() / 8);
+        for (uint32_t corner : tree.cells[c].corners) {
+            if (remap[corner] == UINT32_MAX) {
+                remap[corner] = kept++;
+                values_.insert(values_.end(), tree.values.begin() + static_cast<size_t>(corner) * n,
+                    tree.values.begin() + static_cast<size_t>(corner + 1) * n);
+            }
+            corners_.push_back(remap[corner]);
+        }
+    }
+    corners_.shrink_to_fit();
+    values_.shrink_to_fit();
+
+    // 5. Error of the finished table at every point solved along the way
+    std::vector<double> errors(tree.vertex_keys.size());
+    std::vector<uint32_t> vertices(tree.vertex_keys.size());
+    std::iota(vertices.begin(), vertices.end(), 0);
+    std::for_each(std::execution::par, vertices.begin(), vertices.end(), [&](uint32_t v) {
+        position p = key_position(tree.vertex_keys[v]);
+        const float scale = 255.0f / tree.fine_cells;
+        std::vector<float> k(n);
+        interpolate(p[0] * scale, p[1] * scale, p[2] * scale, k.data());
+        double error = 0.0;
+        for (int i = 0; i < n; ++i) {
+            error = std::max(error, static_cast<double>(std::abs(exact[static_cast<size_t>(v) * n + i] - k[i])));
+        }
+        errors[v] = error;
+        });
+
+    stats_.cells = static_cast<int>(cells_.size());
+    stats_.leaves = static_cast<int>(corners_.size() / 8);
+    stats_.vertices = static_cast<int>(kept);
+    stats_.solves = static_cast<int>(tree.vertex_keys.size());
+    stats_.memory_bytes = (cells_.capacity() + corners_.capacity()) * sizeof(uint32_t) +
+        values_.capacity() * sizeof(float);
+    stats_.max_error = *std::max_element(errors.begin(), errors.end());
+}
+
+const uint32_t* ser::octree_lut::leaf_at(float r, float g, float b, float& tr, float& tg, float& tb) const {
+
+    // Position in root cells, then descend by halving the local coordinates
+    tr = r * ROOT_CELLS / 255.0f;
+    tg = g * ROOT_CELLS / 255.0f;
+    tb = b * ROOT_CELLS / 255.0f;
+    int ir = std::clamp(static_cast<int>(tr), 0, ROOT_CELLS - 1);
+    int ig = std::clamp(static_cast<int>(tg), 0, ROOT_CELLS - 1);
+    int ib = std::clamp(static_cast<int>(tb), 0, ROOT_CELLS - 1);
+    tr -= ir;
+    tg -= ig;
+    tb -= ib;
+
+    uint32_t c = cells_[(ir * ROOT_CELLS + ig) * ROOT_CELLS + ib];
+    while (!(c & LEAF)) {
+        tr *= 2.0f;
+        tg *= 2.0f;
+        tb *= 2.0f;
+        int cr = tr >= 1.0f;
+        int cg = tg >= 1.0f;
+        int cb = tb >= 1.0f;
+        tr -= cr;
+        tg -= cg;
+        tb -= cb;
+        c = cells_[c + ((cr << 2) | (cg << 1) | cb)];
+    }
+    return corners_.data() + static_cast<size_t>(c & ~LEAF) * 8;
+}
+
+void ser::octree_lut::interpolate(float r, float g, float b, float* k) const {
+    const size_t n = palette_.size();
+    float tr, tg, tb;
+    const uint32_t* corners = leaf_at(r, g, b, tr, tg, tb);
+
+    std::fill(k, k + n, 0.0f);
+    for (int corner = 0; corner < 8; ++corner) {
+        float w = corner_weight(corner, tr, tg, tb);
+        const float* v = values_.data() + static_cast<size_t>(corners[corner]) * n;
+        for (size_t i = 0; i < n; ++i) {
+            k[i] += w * v[i];
+        }
+    }
+}
+
+ser::coefficients ser::octree_lut::look_up(const QColor& color) const {
+    std::vector<float> k(palette_.size());
+    look_up(color, k);
+    return { k.begin(), k.end() };
+}
+
+void ser::octree_lut::look_up(const QColor& color, std::span<float> k) const {
+    if (cells_.empty()) return;
+    interpolate(color.red(), color.green(), color.blue(), k.data());
+}
+
+void ser::octree_lut::look_up_row(const QRgb* pixels, int count, float* const* out_rows) const {
+    const size_t n = palette_.size();
+    if (cells_.empty()) return;
+
+    std::vector<float> k(n);
+    for (int x = 0; x < count; ++x) {
+        interpolate(qRed(pixels[x]), qGreen(pixels[x]), qBlue(pixels[x]), k.data());
+        for (size_t i = 0; i < n; ++i) {
+            out_rows[i][x] = k[i];
+        }
+    }
+}
+
+const std::vector<ser::latent_space_color>& ser::octree_lut::palette() const {
+    return palette_;
+}
+
+const ser::octree_stats& ser::octree_lut::stats() const {
+    return stats_;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "color_lut.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <QColor>
+
+namespace ser {
+
+    struct octree_stats {
+        int cells = 0;          // all octree cells, interior and leaf
+        int leaves = 0;
+        int vertices = 0;       // distinct lattice points holding coefficients
+        int hanging = 0;        // vertices pinned to a coarser neighbour's face or edge
+        int solves = 0;         // QP solves, including probes
+        size_t memory_bytes = 0;
+        double max_error = 0.0; // largest deviation from an exact solve at any point solved
+    };
+
+    // Adaptive alternative to color_lut. The RGB cube starts as a coarse
+    // 9x9x9 lattice (8 cells per axis); a cell is split into octants only
+    // where trilinear interpolation of its corners misses the exact QP
+    // solution by more than the tolerance at one of its midpoints: the
+    // center, the face centers and the edge midpoints, which are also the
+    // corners its children need. Flat regions stay coarse while cells along
+    // palette boundaries, where coefficients kink, are refined up to
+    // max_depth levels. At the default depth of 2 the finest cells are those
+    // of the 33^3 color_lut lattice.
+    //
+    // The tree is then 2:1 balanced, so that leaves touching each other
+    // differ by at most one level, and each vertex lying on a face or edge of
+    // a coarser leaf takes that leaf's interpolated value instead of its own
+    // solve. Lookups are therefore continuous across leaves, and a pinned
+    // vertex is one of the coarser leaf's midpoints, so it moves by no more
+    // than the tolerance.
+    //
+    // The tree is pointerless: cells live in one array of 32-bit entries,
+    // the 8 children of a cell stored contiguously. An interior cell's entry
+    // is the index of its first child; a leaf's entry has the top bit set and
+    // indexes its 8 corners, which in turn index a shared vertex array.
+    class octree_lut {
+
+        std::vector<uint32_t> cells_;
+        std::vector<uint32_t> corners_; // 8 vertex indices per leaf, bit 2 = r, bit 1 = g, bit 0 = b
+        std::vector<float> values_;     // n coefficients per vertex
+        std::vector<latent_space_color> palette_;
+        octree_stats stats_;
+
+        const uint32_t* leaf_at(float r, float g, float b, float& tr, float& tg, float& tb) const;
+        void interpolate(float r, float g, float b, float* k) const;
+
+    public:
+
+        octree_lut() {}
+        octree_lut(const std::vector<QColor>& palette, double tolerance = 0.03, int max_depth = 2);
+
+        coefficients look_up(const QColor& color) const;
+        void look_up(const QColor& color, std::span<float> k) const;
+        void look_up_row(const QRgb* pixels, int count, float* const* out_rows) const;
+
+        const std::vector<latent_space_color>& palette() const;
+        const octree_stats& stats() const;
+    };
+
+}
@@ -43,11 +43,17 @@ namespace {
 
         void mousePressEvent(QMouseEvent* event) override {
             if (event->button() == Qt::LeftButton) {
-                QColor new_color = QColorDialog::getColor(color_, this, "Select Color");
-                if (new_color.isValid()) {
-                    color_ = new_color;
-                    update();
-                    emit color_changed();
+                // The swatch follows the dialog while it is dragged, so that
+                // listeners can preview the color; cancelling restores it
+                const QColor original = color_;
+                QColorDialog dialog(color_, this);
+                dialog.setWindowTitle("Select Color");
+                connect(&dialog, &QColorDialog::currentColorChanged, this, &swatch::preview_color);
+                if (dialog.exec() == QDialog::Accepted) {
+                    preview_color(dialog.selectedColor());
+                }
+                else {
+                    preview_color(original);
                 }
             }
             else {
@@ -63,6 +69,13 @@ namespace {
         }
 
     private:
+        void preview_color(const QColor& c) {
+            if (!c.isValid() || c == color_) return;
+            color_ = c;
+            update();
+            emit color_changed();
+        }
+
         QColor color_;
     };
 
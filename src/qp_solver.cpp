@@ -0,0 +1,248 @@
+#include "qp_solver.hpp"
+#include "third-party/mixbox.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+namespace {
+
+    constexpr int LATENT_DIM = MIXBOX_LATENT_SIZE;
+
+    // Multipliers above -MULTIPLIER_TOL are considered non-negative
+    constexpr double MULTIPLIER_TOL = 1e-10;
+
+    // Tolerances for is_optimal, which checks stored float coefficients. The
+    // gradient test is tight enough that accepted nodes match a fresh solve
+    // to float precision; the sum test only has to absorb float rounding.
+    constexpr double OPTIMALITY_TOL = 1e-7;
+    constexpr double CONVEXITY_TOL = 1e-6;
+
+    // Solves the equality-constrained subproblem restricted to the free set:
+    //     minimize k'A_FF k - 2b_F'k  subject to  sum(k_F) = 1
+    // The KKT conditions give k_F = A_FF^-1 (b_F + nu*1), with nu chosen so
+    // that the convexity row holds.
+    Eigen::VectorXd solve_equality_subproblem(const ser::kkt_factorization& kkt, const Eigen::VectorXd& b) {
+        int m = static_cast<int>(kkt.free.size());
+        Eigen::VectorXd b_f(m);
+        for (int i = 0; i < m; ++i) {
+            b_f[i] = b[kkt.free[i]];
+        }
+
+        Eigen::VectorXd y = kkt.llt.solve(b_f);
+        double nu = (1.0 - y.sum()) / kkt.w_sum;
+        return y + nu * kkt.w;
+    }
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser::qp_solver Implementation
+// -------------------------------------------------------------------------
+
+ser::qp_solver::qp_solver(const std::vector<latent_space_color>& palette, double lambda) {
+    int n = static_cast<int>(palette.size());
+    V_.resize(LATENT_DIM, n);
+    for (int i = 0; i < n; ++i) {
+        for (int d = 0; d < LATENT_DIM; ++d) {
+            V_(d, i) = palette[i][d];
+        }
+    }
+    A_ = V_.transpose() * V_;
+    A_.diagonal().array() += lambda;
+}
+
+int ser::qp_solver::size() const {
+    return static_cast<int>(A_.rows());
+}
+
+size_t ser::qp_solver::cached_factorizations() const {
+    std::shared_lock lock(cache_mutex_);
+    return cache_.size();
+}
+
+std::shared_ptr<const ser::kkt_factorization> ser::qp_solver::factorize(const std::vector<int>& free) const {
+    int m = static_cast<int>(free.size());
+    Eigen::MatrixXd A_ff(m, m);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < m; ++j) {
+            A_ff(i, j) = A_(free[i], free[j]);
+        }
+    }
+
+    auto kkt = std::make_shared<kkt_factorization>();
+    kkt->free = free;
+    kkt->llt.compute(A_ff);
+    kkt->w = kkt->llt.solve(Eigen::VectorXd::Ones(m));
+    kkt->w_sum = kkt->w.sum();
+    return kkt;
+}
+
+std::shared_ptr<const ser::kkt_factorization> ser::qp_solver::factorization(const std::vector<int>& free) const {
+    if (size() > 64) {
+        return factorize(free);
+    }
+
+    uint64_t key = 0;
+    for (int i : free) {
+        key |= uint64_t{ 1 } << i;
+    }
+
+    {
+        std::shared_lock lock(cache_mutex_);
+        auto it = cache_.find(key);
+        if (it != cache_.end()) {
+            return it->second;
+        }
+    }
+
+    // Factor outside the lock; if another thread got there first keep theirs
+    auto kkt = factorize(free);
+    std::unique_lock lock(cache_mutex_);
+    return cache_.try_emplace(key, std::move(kkt)).first->second;
+}
+
+int ser::qp_solver::solve(const latent_space_color& target, std::span<double> k,
+        std::span<const double> warm_start) const {
+    int n = size();
+
+    Eigen::VectorXd b = target_term(target);
+
+    // Start from the warm start if there is one, otherwise from the
+    // barycenter of the simplex with every ink free. The constraints do not
+    // depend on the target, so any previous solution is a feasible start.
+    Eigen::VectorXd x = Eigen::VectorXd::Constant(n, 1.0 / n);
+    std::vector<bool> fixed(n, false);
+    if (static_cast<int>(warm_start.size()) == n) {
+        for (int i = 0; i < n; ++i) {
+            x[i] = warm_start[i];
+            fixed[i] = (warm_start[i] <= 0.0);
+        }
+    }
+    std::vector<int> free;
+    for (int i = 0; i < n; ++i) {
+        if (!fixed[i]) {
+            free.push_back(i);
+        }
+    }
+    if (free.empty()) {
+        x.setConstant(1.0 / n);
+        fixed.assign(n, false);
+        for (int i = 0; i < n; ++i) {
+            free.push_back(i);
+        }
+    }
+
+    int iterations = 0;
+    const int max_iterations = 4 * n + 8;
+    while (iterations < max_iterations) {
+        ++iterations;
+        Eigen::VectorXd k_f = solve_equality_subproblem(*factorization(free), b);
+
+        // Longest feasible step towards the subproblem optimum
+        double alpha = 1.0;
+        int blocking = -1;
+        for (size_t i = 0; i < free.size(); ++i) {
+            double p = k_f[i] - x[free[i]];
+            if (p < 0.0) {
+                double a = -x[free[i]] / p;
+                if (a < alpha) {
+                    alpha = a;
+                    blocking = static_cast<int>(i);
+                }
+            }
+        }
+
+        if (blocking >= 0) {
+            for (size_t i = 0; i < free.size(); ++i) {
+                x[free[i]] += alpha * (k_f[i] - x[free[i]]);
+            }
+            x[free[blocking]] = 0.0;
+            fixed[free[blocking]] = true;
+            free.erase(free.begin() + blocking);
+            continue;
+        }
+
+        // Full step: take the subproblem solution exactly
+        for (size_t i = 0; i < free.size(); ++i) {
+            x[free[i]] = k_f[i];
+        }
+
+        // Check the multipliers of the inks pinned at zero
+        Eigen::VectorXd grad = A_ * x - b;
+        double nu = 0.0;
+        for (int i : free) {
+            nu += grad[i];
+        }
+        nu /= static_cast<double>(free.size());
+        int release = -1;
+        double most_negative = -MULTIPLIER_TOL;
+        for (int i = 0; i < n; ++i) {
+            if (fixed[i] && grad[i] - nu < most_negative) {
+                most_negative = grad[i] - nu;
+                release = i;
+            }
+        }
+        if (release < 0) {
+            break;
+        }
+
+        fixed[release] = false;
+        free.insert(std::upper_bound(free.begin(), free.end(), release), release);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        k[i] = std::clamp(x[i], 0.0, 1.0);
+    }
+    return iterations;
+}
+
+bool ser::qp_solver::is_optimal(const latent_space_color& target, std::span<const double> k) const {
+    int n = size();
+    if (static_cast<int>(k.size()) != n) {
+        return false;
+    }
+
+    Eigen::VectorXd x(n);
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) {
+        x[i] = k[i];
+        sum += k[i];
+        if (k[i] < 0.0) {
+            return false;
+        }
+    }
+    if (std::abs(sum - 1.0) > CONVEXITY_TOL) {
+        return false;
+    }
+
+    Eigen::VectorXd grad = A_ * x - target_term(target);
+    double nu = 0.0;
+    int in_use = 0;
+    for (int i = 0; i < n; ++i) {
+        if (x[i] > 0.0) {
+            nu += grad[i];
+            ++in_use;
+        }
+    }
+    nu /= in_use;
+
+    for (int i = 0; i < n; ++i) {
+        double reduced = grad[i] - nu;
+        if (x[i] > 0.0 ? std::abs(reduced) > OPTIMALITY_TOL : reduced < -OPTIMALITY_TOL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Eigen::VectorXd ser::qp_solver::target_term(const latent_space_color& target) const {
+    Eigen::VectorXd t(LATENT_DIM);
+    for (int d = 0; d < LATENT_DIM; ++d) {
+        t[d] = target[d];
+    }
+    return V_.transpose() * t;
+}
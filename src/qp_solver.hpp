@@ -0,0 +1,75 @@
+#pragma once
+
+#include "color_lut.hpp"
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include <Eigen/Dense>
+
+namespace ser {
+
+    // Identifies the solvers' output in the on-disk LUT and solution caches;
+    // bump whenever a change to qp_solver or the Clp path alters solutions
+    inline constexpr uint32_t SOLVER_VERSION = 2;
+
+    // Factorized KKT system of one active set: the Cholesky factor of the
+    // free block A_FF together with w = A_FF^-1 * 1, so that solving the
+    // equality-constrained subproblem costs two back-substitutions.
+    struct kkt_factorization {
+        std::vector<int> free;
+        Eigen::LLT<Eigen::MatrixXd> llt;
+        Eigen::VectorXd w;
+        double w_sum;
+    };
+
+    // Dedicated solver for the per-node ink QP
+    //
+    //     minimize   k'(V'V + lambda*I)k - 2(V'T)'k
+    //     subject to sum(k) = 1,  0 <= k <= 1
+    //
+    // using a primal active-set method on the (small, dense) palette system.
+    // Given sum(k) = 1 and k >= 0 the upper bound is implied, so only the
+    // non-negativity constraints ever enter the working set. Solutions match
+    // the Clp barrier path (qp_backend::clp) to within 1e-6; the
+    // bench_qp_solver tool checks this and times both bakes.
+    //
+    // The Hessian is shared by every target, so the factorization of each
+    // active set is cached, keyed by the bitmask of free inks, and reused by
+    // all threads for the lifetime of the solver. Palettes of more than 64
+    // inks bypass the cache.
+    class qp_solver {
+
+        Eigen::MatrixXd V_; // LATENT_DIM x n, one palette color per column
+        Eigen::MatrixXd A_; // V'V + lambda*I
+
+        mutable std::shared_mutex cache_mutex_;
+        mutable std::unordered_map<uint64_t, std::shared_ptr<const kkt_factorization>> cache_;
+
+        std::shared_ptr<const kkt_factorization> factorize(const std::vector<int>& free) const;
+        std::shared_ptr<const kkt_factorization> factorization(const std::vector<int>& free) const;
+        Eigen::VectorXd target_term(const latent_space_color& target) const; // V'T
+
+    public:
+
+        qp_solver(const std::vector<latent_space_color>& palette, double lambda);
+
+        int size() const;
+        size_t cached_factorizations() const;
+
+        // Solves for the given target, writing the coefficients into k.
+        // A previous solution (any feasible point) may be passed as warm_start;
+        // its zero entries seed the working set, so a neighbouring lattice node
+        // with the same active set converges after a single subproblem.
+        // Returns the number of equality-constrained subproblems solved.
+        int solve(const latent_space_color& target, std::span<double> k,
+            std::span<const double> warm_start = {}) const;
+
+        // True if k satisfies the KKT conditions for target: equal reduced
+        // gradients on the inks in use, none smaller on the inks left out.
+        bool is_optimal(const latent_space_color& target, std::span<const double> k) const;
+    };
+
+}
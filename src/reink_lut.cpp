@@ -0,0 +1,187 @@
+#include "reink_lut.hpp"
+#include "lut_kernels.hpp"
+#include "simd_support.hpp"
+#include "third-party/mixbox.h"
+
+#include <algorithm>
+#include <atomic>
+#include <execution>
+#include <numeric>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+namespace {
+
+    // Floats per node: b, g, r and 255, the byte order of a QRgb
+    constexpr int NODE_STRIDE = 4;
+
+    // Mixes one node's coefficients with the target palette into 0..255 RGB
+    void mix_node(std::span<const float> k, const std::vector<ser::latent_space_color>& palette, float* out) {
+        mixbox_latent mixed = { 0 };
+        for (size_t i = 0; i < k.size(); ++i) {
+            for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+                mixed[d] += k[i] * palette[i][d];
+            }
+        }
+
+        float r, g, b;
+        mixbox_latent_to_float_rgb(mixed, &r, &g, &b);
+        out[0] = b * 255.0f;
+        out[1] = g * 255.0f;
+        out[2] = r * 255.0f;
+        out[3] = 255.0f;
+    }
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser::reink_lut Implementation
+// -------------------------------------------------------------------------
+
+ser::reink_lut::reink_lut(const color_lut& source, const std::vector<latent_space_color>& target) {
+    if (source.palette().empty() || source.palette().size() != target.size()) return;
+
+    // 1. Mix every node of the source lattice with the target palette
+    source.solve_all();
+    const int g = source.grid_size();
+    grid_size_ = g;
+    nodes_.resize(static_cast<size_t>(g) * g * g * NODE_STRIDE);
+    std::vector<int> slabs(g);
+    std::iota(slabs.begin(), slabs.end(), 0);
+    std::for_each(std::execution::par, slabs.begin(), slabs.end(), [&](int r) {
+        for (int gg = 0; gg < g; ++gg) {
+            for (int b = 0; b < g; ++b) {
+                size_t node = (static_cast<size_t>(r) * g + gg) * g + b;
+                mix_node(source.node(r, gg, b), target, nodes_.data() + node * NODE_STRIDE);
+            }
+        }
+        });
+
+    // 2. Cell offsets and fractions per channel value, the same positions
+    // color_lut looks up
+    for (int v = 0; v < 256; ++v) {
+        float pos = v * (g - 1) / 255.0f;
+        uint32_t cell = static_cast<uint32_t>(std::clamp(static_cast<int>(pos), 0, g - 2));
+        r_offset_[v] = cell * g * g * NODE_STRIDE;
+        g_offset_[v] = cell * g * NODE_STRIDE;
+        b_offset_[v] = cell * NODE_STRIDE;
+        fraction_[v] = pos - cell;
+    }
+}
+
+ser::reink_lut::reink_lut(const color_lut& source, const std::vector<QColor>& target) :
+        reink_lut(source, to_latent_space(target)) {
+}
+
+int ser::reink_lut::update_ink(const color_lut& source, const std::vector<latent_space_color>& target, size_t ink) {
+    if (nodes_.empty() || source.grid_size() != grid_size_ || source.palette().size() != target.size()) {
+        *this = reink_lut(source, target);
+        return static_cast<int>(nodes_.size() / NODE_STRIDE);
+    }
+    if (ink >= target.size()) {
+        changed_cells_.assign(static_cast<size_t>(grid_size_) * grid_size_ * grid_size_, 0);
+        return 0;
+    }
+
+    // 1. Remix the nodes the ink enters into, exactly as the constructor
+    // would. Elsewhere it adds nothing to the mix.
+    const int g = grid_size_;
+    std::vector<uint8_t> remixed_nodes(static_cast<size_t>(g) * g * g, 0);
+    std::vector<int> slabs(g);
+    std::iota(slabs.begin(), slabs.end(), 0);
+    std::atomic<int> remixed = 0;
+    std::for_each(std::execution::par, slabs.begin(), slabs.end(), [&](int r) {
+        int slab_remixed = 0;
+        for (int gg = 0; gg < g; ++gg) {
+            for (int b = 0; b < g; ++b) {
+                auto k = source.node(r, gg, b);
+                if (k[ink] == 0.0f) continue;
+
+                size_t node = node_index(r, gg, b, g);
+                mix_node(k, target, nodes_.data() + node * NODE_STRIDE);
+                remixed_nodes[node] = 1;
+                ++slab_remixed;
+            }
+        }
+        remixed += slab_remixed;
+        });
+
+    // 2. A color looks up to something new if any corner of its cell was
+    // remixed
+    changed_cells_.assign(remixed_nodes.size(), 0);
+    slabs.pop_back();
+    std::for_each(std::execution::par, slabs.begin(), slabs.end(), [&](int r) {
+        for (int gg = 0; gg < g - 1; ++gg) {
+            for (int b = 0; b < g - 1; ++b) {
+                uint8_t any = 0;
+                for (int corner = 0; corner < 8; ++corner) {
+                    any |= remixed_nodes[node_index(r + (corner >> 2), gg + ((corner >> 1) & 1), b + (corner & 1), g)];
+                }
+                changed_cells_[node_index(r, gg, b, g)] = any;
+            }
+        }
+        });
+    return remixed;
+}
+
+int ser::reink_lut::update_ink(const color_lut& source, const std::vector<QColor>& target, size_t ink) {
+    return update_ink(source, to_latent_space(target), ink);
+}
+
+bool ser::reink_lut::empty() const {
+    return nodes_.empty();
+}
+
+bool ser::reink_lut::changed(QRgb rgb) const {
+    if (changed_cells_.empty()) return true;
+    size_t offset = r_offset_[qRed(rgb)] + g_offset_[qGreen(rgb)] + b_offset_[qBlue(rgb)];
+    return changed_cells_[offset / NODE_STRIDE] != 0;
+}
+
+QRgb ser::reink_lut::look_up(QRgb rgb) const {
+    QRgb out;
+    look_up_row(&rgb, 1, &out);
+    return out;
+}
+
+void ser::reink_lut::look_up_row(const QRgb* pixels, int count, QRgb* out) const {
+    if (nodes_.empty()) return;
+
+    const uint32_t r_step = grid_size_ * grid_size_ * NODE_STRIDE;
+    const uint32_t g_step = grid_size_ * NODE_STRIDE;
+    const uint32_t b_step = NODE_STRIDE;
+    const float* nodes = nodes_.data();
+
+    int x = 0;
+#if SERIGRAPH_BUILD_AVX2
+    if (cpu_has_avx2()) {
+        x = kernels::reink_row_avx2(nodes, grid_size_, pixels, count, out);
+    }
+#endif
+    for (; x < count; ++x) {
+        int r = qRed(pixels[x]);
+        int g = qGreen(pixels[x]);
+        int b = qBlue(pixels[x]);
+        float tr = fraction_[r];
+        float tg = fraction_[g];
+        float tb = fraction_[b];
+
+        // The same tetrahedron color_lut would blend
+        tetrahedron t = select_tetrahedron(tr, tg, tb, r_step, g_step, b_step);
+        const float* c0 = nodes + r_offset_[r] + g_offset_[g] + b_offset_[b];
+        const float* c1 = c0 + t.first;
+        const float* c2 = c0 + t.second;
+        const float* c3 = c0 + r_step + g_step + b_step;
+
+        float v[3];
+        for (int c = 0; c < 3; ++c) {
+            v[c] = t.w[0] * c0[c] + t.w[1] * c1[c] + t.w[2] * c2[c] + t.w[3] * c3[c];
+        }
+        out[x] = qRgb(static_cast<int>(v[2] + 0.5f), static_cast<int>(v[1] + 0.5f), static_cast<int>(v[0] + 0.5f));
+    }
+}
+
+size_t ser::reink_lut::memory_usage() const {
+    return nodes_.capacity() * sizeof(float);
+}
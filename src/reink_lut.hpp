@@ -0,0 +1,66 @@
+#pragma once
+
+#include "color_lut.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <QColor>
+
+namespace ser {
+
+    // Re-inking with a new target palette as a direct RGB -> RGB map. For a
+    // fixed source LUT the re-inked color depends only on the source color,
+    // so each node of the source lattice is mixed once with the target
+    // palette (one mixbox evaluation per node, 35,937 for a full LUT) and a
+    // pixel then costs a single tetrahedral lookup instead of separating,
+    // mixing in latent space and converting back.
+    //
+    // The node colors are stored as b, g, r, 255 floats, the byte order of
+    // a QRgb, so a blended node packs straight into a pixel.
+    // Interpolating the mixed colors rather than the coefficients differs
+    // from ink_layers_to_image only where the mixbox polynomial bends
+    // within a cell.
+    class reink_lut {
+
+        aligned_vector<float> nodes_;
+        int grid_size_ = 0;
+
+        // Per channel value: the cell's offset into nodes_ along that axis,
+        // and the fraction of the way across the cell
+        std::array<uint32_t, 256> r_offset_ = {};
+        std::array<uint32_t, 256> g_offset_ = {};
+        std::array<uint32_t, 256> b_offset_ = {};
+        std::array<float, 256> fraction_ = {};
+
+        // Per cell, by its lower corner node: whether the last update_ink
+        // remixed any of its corners. Empty when every cell is new.
+        std::vector<uint8_t> changed_cells_;
+
+    public:
+
+        reink_lut() {}
+
+        // Empty if the palettes differ in size
+        reink_lut(const color_lut& source, const std::vector<latent_space_color>& target);
+        reink_lut(const color_lut& source, const std::vector<QColor>& target);
+
+        // Remixes, for a target palette that changed in one ink only, every
+        // node where that ink's coefficient is not zero. The other nodes do
+        // not depend on the ink, so the table ends up the same as one built
+        // from scratch. Returns the number of nodes remixed.
+        int update_ink(const color_lut& source, const std::vector<latent_space_color>& target, size_t ink);
+        int update_ink(const color_lut& source, const std::vector<QColor>& target, size_t ink);
+
+        bool empty() const;
+
+        // Whether the last update_ink changed what rgb looks up to, that is
+        // whether any corner of its cell was remixed. True for every color
+        // of a table built from scratch.
+        bool changed(QRgb rgb) const;
+
+        QRgb look_up(QRgb rgb) const;
+        void look_up_row(const QRgb* pixels, int count, QRgb* out) const;
+        size_t memory_usage() const;
+    };
+
+}
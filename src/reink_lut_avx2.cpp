@@ -0,0 +1,58 @@
+#include "lut_kernels.hpp"
+
+#include <immintrin.h>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+// This unit alone is built with AVX2 and FMA enabled.
+namespace {
+
+    // Floats per node: b, g, r and 255, as in reink_lut.cpp
+    constexpr int NODE_STRIDE = 4;
+
+}
+
+// -------------------------------------------------------------------------
+// ser::kernels Free Functions
+// -------------------------------------------------------------------------
+
+// Eight pixels at a time: cells, fractions and tetrahedra are worked out
+// across the eight lanes as in color_lut's row kernel, then each pixel
+// blends its 4 corners as one vector of b, g, r, 255 and packs it
+// straight into a QRgb.
+int ser::kernels::reink_row_avx2(const float* nodes, int grid, const QRgb* pixels, int count, QRgb* out) {
+    const int r_stride = grid * grid * NODE_STRIDE;
+    const int g_stride = grid * NODE_STRIDE;
+
+    alignas(32) int base[8];
+    alignas(32) int first[8], second[8];
+    alignas(32) float w[4][8];
+    const __m128 half = _mm_set1_ps(0.5f);
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + x));
+        lattice_position8 pos = locate8(px, grid, NODE_STRIDE);
+        tetrahedron8 t = select_tetrahedron8(pos.tr, pos.tg, pos.tb, r_stride, g_stride, NODE_STRIDE);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(base), pos.base);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(first), t.first);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(second), t.second);
+        for (int c = 0; c < 4; ++c) {
+            _mm256_store_ps(w[c], t.w[c]);
+        }
+
+        for (int lane = 0; lane < 8; ++lane) {
+            const float* c0 = nodes + base[lane];
+            __m128 v = _mm_mul_ps(_mm_set1_ps(w[0][lane]), _mm_load_ps(c0));
+            v = _mm_fmadd_ps(_mm_set1_ps(w[1][lane]), _mm_load_ps(c0 + first[lane]), v);
+            v = _mm_fmadd_ps(_mm_set1_ps(w[2][lane]), _mm_load_ps(c0 + second[lane]), v);
+            v = _mm_fmadd_ps(_mm_set1_ps(w[3][lane]), _mm_load_ps(c0 + r_stride + g_stride + NODE_STRIDE), v);
+
+            // Truncating after adding one half rounds like the scalar path
+            __m128i c = _mm_cvttps_epi32(_mm_add_ps(v, half));
+            c = _mm_packus_epi32(c, c);
+            out[x + lane] = static_cast<QRgb>(_mm_cvtsi128_si32(_mm_packus_epi16(c, c)));
+        }
+    }
+    return x;
+}
@@ -0,0 +1,539 @@
+#include "separation_file.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <execution>
+#include <numeric>
+#include <type_traits>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+namespace {
+
+    constexpr char SEP_MAGIC[8] = { 'S', 'E', 'R', 'I', 'S', 'E', 'P', '\0' };
+
+    // Bump whenever the on-disk layout or a codec changes
+    constexpr uint32_t SEP_FILE_VERSION = 2;
+
+    constexpr size_t SEP_ALIGNMENT = 64;
+
+    constexpr int TILE_WIDTH = ser::ink_separation::TILE_WIDTH;
+    constexpr int TILE_HEIGHT = ser::ink_separation::TILE_HEIGHT;
+
+    struct separation_file_header {
+        char magic[8];
+        uint32_t file_version;
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t ink_count;
+        uint32_t tile_width;
+        uint32_t tile_height;
+        uint32_t reserved0;
+        uint64_t index_checksum;
+        uint64_t reserved[2];
+    };
+    static_assert(sizeof(separation_file_header) == SEP_ALIGNMENT);
+
+    enum chunk_codec : uint8_t {
+        CHUNK_ZERO = 0,
+        CHUNK_RAW = 1,
+        CHUNK_DELTA_RLE = 2
+    };
+
+    // Where one ink's chunk of one tile is and the checksum of its bytes;
+    // entries run ink by ink within a tile and tile by tile
+    struct tile_entry {
+        uint64_t offset;
+        uint64_t checksum;
+        uint32_t bytes;
+        uint8_t codec;
+        uint8_t marked;
+        uint16_t reserved;
+    };
+    static_assert(sizeof(tile_entry) == 24);
+
+    // Runs of unchanged samples shorter than this cost less as literals
+    constexpr size_t MIN_REPEAT = 3;
+
+    constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+    constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+    // FNV-1a over the 32-bit words of bytes, then over any bytes left.
+    // Chunks lie at any offset in the mapping, so words are copied out
+    // rather than read in place.
+    uint64_t checksum(const uint8_t* data, size_t bytes) {
+        uint64_t h = FNV_OFFSET;
+        size_t i = 0;
+        for (; i + sizeof(uint32_t) <= bytes; i += sizeof(uint32_t)) {
+            uint32_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            h ^= word;
+            h *= FNV_PRIME;
+        }
+        for (; i < bytes; ++i) {
+            h ^= data[i];
+            h *= FNV_PRIME;
+        }
+        return h;
+    }
+
+    // Entry slot of the index that starts at index, copied out of the file
+    tile_entry index_entry(const uint8_t* index, size_t slot) {
+        tile_entry entry;
+        std::memcpy(&entry, index + slot * sizeof(tile_entry), sizeof(entry));
+        return entry;
+    }
+
+    size_t palette_bytes(size_t ink_count) {
+        size_t bytes = ink_count * sizeof(QRgb);
+        return (bytes + SEP_ALIGNMENT - 1) / SEP_ALIGNMENT * SEP_ALIGNMENT;
+    }
+
+    size_t index_offset(size_t ink_count) {
+        return sizeof(separation_file_header) + 2 * palette_bytes(ink_count);
+    }
+
+    std::vector<QRgb> padded_palette(const std::vector<QColor>& colors) {
+        std::vector<QRgb> palette(palette_bytes(colors.size()) / sizeof(QRgb), 0);
+        for (size_t i = 0; i < colors.size(); ++i) {
+            palette[i] = colors[i].rgb();
+        }
+        return palette;
+    }
+
+    int count_tiles(int size, int tile_size) {
+        return (size + tile_size - 1) / tile_size;
+    }
+
+    struct tile_rect {
+        int x0;
+        int y0;
+        int count;
+        int rows;
+    };
+
+    tile_rect tile_bounds(int tile, int tiles_x, int wd, int hgt) {
+        int x0 = (tile % tiles_x) * TILE_WIDTH;
+        int y0 = (tile / tiles_x) * TILE_HEIGHT;
+        return { x0, y0, std::min(TILE_WIDTH, wd - x0), std::min(TILE_HEIGHT, hgt - y0) };
+    }
+
+    void put_varint(std::vector<uint8_t>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<uint8_t>(v) | 0x80);
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p == end) return false;
+            uint8_t b = *p++;
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // Deltas are taken modulo the sample type and stored zigzagged, so that
+    // small steps either way take one byte
+    template <typename T>
+    uint64_t zigzag(T delta) {
+        int64_t s = static_cast<std::make_signed_t<T>>(delta);
+        return (static_cast<uint64_t>(s) << 1) ^ static_cast<uint64_t>(s >> 63);
+    }
+
+    template <typename T>
+    T unzigzag(uint64_t z) {
+        return static_cast<T>((z >> 1) ^ (~(z & 1) + 1));
+    }
+
+    // The stream is a sequence of runs, each a varint (length << 1 | repeat).
+    // A repeat run holds the previous sample; a literal run is followed by
+    // one zigzag varint delta to the previous sample per sample. Samples go
+    // row by row through the tile, the first one predicted by zero.
+    template <typename T>
+    void encode_delta_rle(std::span<const T> samples, std::vector<uint8_t>& out) {
+        const size_t n = samples.size();
+        size_t literal_start = 0;
+        auto flush_literals = [&](size_t end) {
+            if (end == literal_start) return;
+            put_varint(out, (end - literal_start) << 1);
+            T prev = literal_start ? samples[literal_start - 1] : T(0);
+            for (size_t k = literal_start; k < end; ++k) {
+                put_varint(out, zigzag<T>(static_cast<T>(samples[k] - prev)));
+                prev = samples[k];
+            }
+            };
+
+        size_t i = 0;
+        while (i < n) {
+            T prev = i ? samples[i - 1] : T(0);
+            size_t run = i;
+            while (run < n && samples[run] == prev) ++run;
+            if (run - i >= MIN_REPEAT) {
+                flush_literals(i);
+                put_varint(out, ((run - i) << 1) | 1);
+                literal_start = run;
+            }
+            i = std::max(run, i + 1);
+        }
+        flush_literals(n);
+    }
+
+    template <typename T>
+    bool decode_delta_rle(const uint8_t* p, const uint8_t* end, T* samples, size_t n) {
+        T prev = 0;
+        size_t i = 0;
+        while (i < n) {
+            uint64_t header;
+            if (!get_varint(p, end, header)) return false;
+            uint64_t run = header >> 1;
+            if (run == 0 || run > n - i) return false;
+            if (header & 1) {
+                std::fill_n(samples + i, run, prev);
+                i += run;
+                continue;
+            }
+            for (uint64_t k = 0; k < run; ++k) {
+                uint64_t z;
+                if (!get_varint(p, end, z)) return false;
+                prev = static_cast<T>(prev + unzigzag<T>(z));
+                samples[i++] = prev;
+            }
+        }
+        return p == end;
+    }
+
+    // Encodes one ink's tile into out and returns its codec
+    template <typename T>
+    chunk_codec encode_tile(ser::const_ink_layer layer, const tile_rect& r, std::vector<T>& samples,
+            std::vector<uint8_t>& out) {
+        samples.resize(static_cast<size_t>(r.count) * r.rows);
+        for (int y = 0; y < r.rows; ++y) {
+            const T* row = layer.row<T>(r.y0 + y) + r.x0;
+            std::copy(row, row + r.count, samples.begin() + static_cast<size_t>(y) * r.count);
+        }
+        if (std::all_of(samples.begin(), samples.end(), [](T v) { return v == 0; })) return CHUNK_ZERO;
+
+        encode_delta_rle<T>(samples, out);
+        if (out.size() < samples.size() * sizeof(T)) return CHUNK_DELTA_RLE;
+        out.resize(samples.size() * sizeof(T));
+        std::memcpy(out.data(), samples.data(), out.size());
+        return CHUNK_RAW;
+    }
+
+    // Decodes one ink's chunk of a tile into layer, after checking it
+    // against its checksum. A zero chunk is skipped if the layer is known
+    // to be zero already. Raw chunks need not be aligned for T, so they
+    // are only ever copied as bytes.
+    template <typename T>
+    bool decode_tile(const uint8_t* data, const tile_entry& entry, const tile_rect& r, bool zeroed,
+            std::vector<T>& samples, ser::ink_layer layer) {
+        const size_t n = static_cast<size_t>(r.count) * r.rows;
+        const uint8_t* chunk = data + entry.offset;
+        if (entry.codec != CHUNK_ZERO && checksum(chunk, entry.bytes) != entry.checksum) return false;
+
+        const uint8_t* src = chunk;
+        switch (entry.codec) {
+        case CHUNK_ZERO:
+            for (int y = 0; y < r.rows && !zeroed; ++y) {
+                std::fill_n(layer.row<T>(r.y0 + y) + r.x0, r.count, T(0));
+            }
+            return true;
+        case CHUNK_RAW:
+            if (entry.bytes != n * sizeof(T)) return false;
+            break;
+        default:
+            samples.resize(n);
+            if (!decode_delta_rle(chunk, chunk + entry.bytes, samples.data(), n)) {
+                return false;
+            }
+            src = reinterpret_cast<const uint8_t*>(samples.data());
+            break;
+        }
+        const size_t row_bytes = r.count * sizeof(T);
+        for (int y = 0; y < r.rows; ++y) {
+            std::memcpy(layer.row<T>(r.y0 + y) + r.x0, src + y * row_bytes, row_bytes);
+        }
+        return true;
+    }
+
+    // Calls f with a value of the sample type of format, floats as their bits
+    template <typename F>
+    auto with_sample_type(ser::ink_format format, F&& f) {
+        switch (format) {
+        case ser::ink_format::uint8:
+            return f(uint8_t{});
+        case ser::ink_format::uint16:
+            return f(uint16_t{});
+        default:
+            return f(uint32_t{});
+        }
+    }
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser::separation_file Implementation
+// -------------------------------------------------------------------------
+
+ser::separation_file::separation_file(std::unique_ptr<QFile> file, const uint8_t* map, size_t size) :
+        file_(std::move(file)), map_(map), size_(size) {
+    separation_file_header header;
+    std::memcpy(&header, map_, sizeof(header));
+    wd_ = static_cast<int>(header.width);
+    hgt_ = static_cast<int>(header.height);
+    inks_ = header.ink_count;
+    format_ = static_cast<ink_format>(header.format);
+
+    const uint8_t* palettes = map_ + sizeof(separation_file_header);
+    for (size_t i = 0; i < inks_; ++i) {
+        QRgb source, target;
+        std::memcpy(&source, palettes + i * sizeof(QRgb), sizeof(QRgb));
+        std::memcpy(&target, palettes + palette_bytes(inks_) + i * sizeof(QRgb), sizeof(QRgb));
+        palette_.push_back(QColor(source));
+        target_palette_.push_back(QColor(target));
+    }
+}
+
+ser::separation_file::~separation_file() = default;
+
+int ser::separation_file::tiles_x() const {
+    return count_tiles(wd_, TILE_WIDTH);
+}
+
+int ser::separation_file::tiles_y() const {
+    return count_tiles(hgt_, TILE_HEIGHT);
+}
+
+int ser::separation_file::width() const {
+    return wd_;
+}
+
+int ser::separation_file::height() const {
+    return hgt_;
+}
+
+size_t ser::separation_file::size() const {
+    return inks_;
+}
+
+ser::ink_format ser::separation_file::format() const {
+    return format_;
+}
+
+size_t ser::separation_file::file_size() const {
+    return size_;
+}
+
+const std::vector<QColor>& ser::separation_file::palette() const {
+    return palette_;
+}
+
+const std::vector<QColor>& ser::separation_file::target_palette() const {
+    return target_palette_;
+}
+
+bool ser::separation_file::read_tile(int tile, ink_separation& layers, bool zeroed) const {
+    const uint8_t* index = map_ + index_offset(inks_);
+    const tile_rect r = tile_bounds(tile, tiles_x(), wd_, hgt_);
+    return with_sample_type(format_, [&](auto sample) {
+        using T = decltype(sample);
+        std::vector<T> samples;
+        for (size_t i = 0; i < inks_; ++i) {
+            const tile_entry entry = index_entry(index, static_cast<size_t>(tile) * inks_ + i);
+            if (!decode_tile<T>(map_, entry, r, zeroed, samples, layers[i])) return false;
+            if (entry.marked) layers.mark_ink(tile, i);
+        }
+        return true;
+        });
+}
+
+bool ser::separation_file::has_coverage(int tile, size_t ink) const {
+    if (tile < 0 || tile >= tiles_x() * tiles_y() || ink >= inks_) return false;
+    return index_entry(map_ + index_offset(inks_), static_cast<size_t>(tile) * inks_ + ink).codec != CHUNK_ZERO;
+}
+
+int ser::separation_file::read_tiles(std::span<const int> tiles, ink_separation& layers,
+        const job_control& job, bool zeroed) const {
+    if (layers.size() != inks_ || layers.width() != wd_ || layers.height() != hgt_ || layers.format() != format_) {
+        return -1;
+    }
+    const int tile_count = tiles_x() * tiles_y();
+    if (std::any_of(tiles.begin(), tiles.end(), [&](int t) { return t < 0 || t >= tile_count; })) return -1;
+
+    // Tiles are independent chunks, so they decode in parallel
+    const int tiles_per_report = std::max(1, static_cast<int>(tiles.size()) / 100);
+    std::atomic<int> tiles_done = 0;
+    std::atomic<bool> corrupt = false;
+    std::for_each(std::execution::par, tiles.begin(), tiles.end(), [&](int tile) {
+        if (corrupt || job.stop_requested()) return;
+        if (!read_tile(tile, layers, zeroed)) corrupt = true;
+
+        int done = ++tiles_done;
+        if (done % tiles_per_report == 0) {
+            job.report(static_cast<double>(done) / tiles.size());
+        }
+        });
+    if (corrupt || job.stop_requested()) return -1;
+    return static_cast<int>(tiles.size());
+}
+
+ser::ink_separation ser::separation_file::read(const job_control& job) const {
+    ink_separation layers(inks_, wd_, hgt_, format_);
+    std::vector<int> tiles(tiles_x() * tiles_y());
+    std::iota(tiles.begin(), tiles.end(), 0);
+    // A new separation starts out zero, so the empty chunks, most of a
+    // typical file, cost nothing
+    if (read_tiles(tiles, layers, job, true) < 0) return {};
+    return layers;
+}
+
+std::shared_ptr<const ser::separation_file> ser::separation_file::open(const QString& path) {
+    if (path.isEmpty() || !QFile::exists(path)) {
+        return nullptr;
+    }
+
+    auto file = std::make_unique<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+    const size_t size = static_cast<size_t>(file->size());
+    if (size < sizeof(separation_file_header)) {
+        return nullptr;
+    }
+
+    const uint8_t* map = file->map(0, file->size());
+    if (!map) {
+        return nullptr;
+    }
+
+    // 1. The header must describe a separation this build can tile the same way
+    separation_file_header header;
+    std::memcpy(&header, map, sizeof(header));
+    bool valid = std::equal(std::begin(SEP_MAGIC), std::end(SEP_MAGIC), header.magic) &&
+        header.file_version == SEP_FILE_VERSION &&
+        header.tile_width == static_cast<uint32_t>(TILE_WIDTH) &&
+        header.tile_height == static_cast<uint32_t>(TILE_HEIGHT) &&
+        header.format <= static_cast<uint32_t>(ink_format::uint8) &&
+        header.ink_count > 0 && header.width > 0 && header.height > 0 &&
+        header.width <= INT_MAX && header.height <= INT_MAX;
+    if (!valid) {
+        return nullptr;
+    }
+
+    // 2. The index must fit and match its checksum, and every chunk must lie
+    // within the file, so that decoding never reads outside the mapping.
+    // The chunks' own checksums are checked as they are decoded.
+    const size_t inks = header.ink_count;
+    const size_t entries = static_cast<size_t>(count_tiles(header.width, TILE_WIDTH)) *
+        count_tiles(header.height, TILE_HEIGHT) * inks;
+    const size_t chunks_offset = index_offset(inks) + entries * sizeof(tile_entry);
+    if (chunks_offset > size) {
+        return nullptr;
+    }
+    const uint8_t* index = map + index_offset(inks);
+    if (checksum(index, entries * sizeof(tile_entry)) != header.index_checksum) {
+        return nullptr;
+    }
+    for (size_t slot = 0; slot < entries; ++slot) {
+        const tile_entry entry = index_entry(index, slot);
+        valid = entry.codec <= CHUNK_DELTA_RLE && (entry.codec != CHUNK_ZERO || entry.bytes == 0) &&
+            entry.offset >= chunks_offset && entry.offset <= size && entry.bytes <= size - entry.offset;
+        if (!valid) {
+            return nullptr;
+        }
+    }
+
+    return std::make_shared<const separation_file>(std::move(file), map, size);
+}
+
+bool ser::separation_file::write(const QString& path, const ink_separation& layers,
+        const std::vector<QColor>& palette, const std::vector<QColor>& target_palette, const job_control& job) {
+    const size_t inks = layers.size();
+    if (path.isEmpty() || inks == 0 || palette.size() != inks || target_palette.size() != inks) {
+        return false;
+    }
+
+    // 1. Encode every tile of every ink in parallel
+    const int tiles_x = layers.tiles_x();
+    const int tile_count = tiles_x * layers.tiles_y();
+    std::vector<tile_entry> index(static_cast<size_t>(tile_count) * inks, tile_entry{});
+    std::vector<std::vector<uint8_t>> chunks(index.size());
+    std::vector<int> tiles(tile_count);
+    std::iota(tiles.begin(), tiles.end(), 0);
+
+    const int tiles_per_report = std::max(1, tile_count / 100);
+    std::atomic<int> tiles_done = 0;
+    std::for_each(std::execution::par, tiles.begin(), tiles.end(), [&](int tile) {
+        if (job.stop_requested()) return;
+        const tile_rect r = tile_bounds(tile, tiles_x, layers.width(), layers.height());
+        with_sample_type(layers.format(), [&](auto sample) {
+            using T = decltype(sample);
+            std::vector<T> samples;
+            for (size_t i = 0; i < inks; ++i) {
+                size_t slot = static_cast<size_t>(tile) * inks + i;
+                index[slot].codec = encode_tile<T>(layers[i], r, samples, chunks[slot]);
+                index[slot].marked = layers.has_ink(tile, i) ? 1 : 0;
+            }
+            });
+
+        int done = ++tiles_done;
+        if (done % tiles_per_report == 0) {
+            job.report(static_cast<double>(done) / tile_count);
+        }
+        });
+    if (job.stop_requested()) {
+        return false;
+    }
+
+    // 2. Lay the chunks out after the index
+    uint64_t offset = index_offset(inks) + index.size() * sizeof(tile_entry);
+    for (size_t slot = 0; slot < index.size(); ++slot) {
+        index[slot].offset = offset;
+        index[slot].checksum = checksum(chunks[slot].data(), chunks[slot].size());
+        index[slot].bytes = static_cast<uint32_t>(chunks[slot].size());
+        offset += chunks[slot].size();
+    }
+
+    separation_file_header header{};
+    std::copy(std::begin(SEP_MAGIC), std::end(SEP_MAGIC), header.magic);
+    header.file_version = SEP_FILE_VERSION;
+    header.format = static_cast<uint32_t>(layers.format());
+    header.width = static_cast<uint32_t>(layers.width());
+    header.height = static_cast<uint32_t>(layers.height());
+    header.ink_count = static_cast<uint32_t>(inks);
+    header.tile_width = TILE_WIDTH;
+    header.tile_height = TILE_HEIGHT;
+    header.index_checksum = checksum(reinterpret_cast<const uint8_t*>(index.data()), index.size() * sizeof(tile_entry));
+
+    // 3. QSaveFile renames into place on commit, so readers never see a
+    // partial file
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    std::vector<QRgb> source = padded_palette(palette);
+    std::vector<QRgb> target = padded_palette(target_palette);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(source.data()), source.size() * sizeof(QRgb));
+    file.write(reinterpret_cast<const char*>(target.data()), target.size() * sizeof(QRgb));
+    file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(tile_entry));
+    for (const auto& chunk : chunks) {
+        file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    }
+    return file.commit();
+}
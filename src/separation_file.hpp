@@ -0,0 +1,89 @@
+#pragma once
+
+#include "ink_layer.hpp"
+#include "job_control.hpp"
+#include <QColor>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+class QFile;
+
+namespace ser {
+
+    // An ink_separation saved to disk (.serisep), mapped read-only so that
+    // tiles are decoded only when asked for. The file layout is
+    //
+    //     separation_file_header (64 bytes)
+    //     palette                (ink_count QRgb values, padded to 64 bytes)
+    //     target palette         (ink_count QRgb values, padded to 64 bytes)
+    //     tile index             (tile_count * ink_count entries of 24 bytes)
+    //     chunks
+    //
+    // in native byte order. Each plane is cut into the separation's tiles
+    // and every tile of every ink is a chunk of its own: nothing for a tile
+    // that is all zero, the samples delta coded and run-length encoded, or
+    // the raw samples if coding does not make them smaller. Coverage is
+    // mostly flat or zero, so the runs take most planes down to a few
+    // percent. The index records each chunk's place, codec and checksum and
+    // whether the ink is marked in the tile, and has a checksum of its own
+    // in the header. open() checks the index; each chunk is checked when it
+    // is decoded.
+    class separation_file {
+
+        std::unique_ptr<QFile> file_;
+        const uint8_t* map_ = nullptr;
+        size_t size_ = 0;
+
+        int wd_ = 0;
+        int hgt_ = 0;
+        size_t inks_ = 0;
+        ink_format format_ = ink_format::uint16;
+        std::vector<QColor> palette_;
+        std::vector<QColor> target_palette_;
+
+        int tiles_x() const;
+        int tiles_y() const;
+        bool read_tile(int tile, ink_separation& layers, bool zeroed) const;
+
+    public:
+
+        // Takes over a file mapped whole whose header open() has checked
+        separation_file(std::unique_ptr<QFile> file, const uint8_t* map, size_t size);
+        ~separation_file();
+
+        int width() const;
+        int height() const;
+        size_t size() const;
+        ink_format format() const;
+        size_t file_size() const;
+
+        // The inks the separation was made with, and the inks it was re-inked
+        // with when saved
+        const std::vector<QColor>& palette() const;
+        const std::vector<QColor>& target_palette() const;
+
+        // Decodes the given tiles, numbered as in ink_separation, of every ink
+        // into layers, which must have this file's size, ink count and format,
+        // and marks their inks. If zeroed, layers are known to be zero in
+        // those tiles and all-zero chunks are skipped. Returns the number of
+        // tiles decoded, or -1 if the job is cancelled or a chunk is corrupt.
+        int read_tiles(std::span<const int> tiles, ink_separation& layers, const job_control& job = {},
+            bool zeroed = false) const;
+
+        // False if the ink's chunk of the tile is all zero, so that the ink
+        // adds nothing to the tile's mix
+        bool has_coverage(int tile, size_t ink) const;
+
+        // Decodes the whole separation; empty if cancelled or corrupt
+        ink_separation read(const job_control& job = {}) const;
+
+        // Maps the file at path if it is a separation file, else nullptr
+        static std::shared_ptr<const separation_file> open(const QString& path);
+        static bool write(const QString& path, const ink_separation& layers, const std::vector<QColor>& palette,
+            const std::vector<QColor>& target_palette, const job_control& job = {});
+    };
+
+}
@@ -1,4 +1,11 @@
 #include "serigraph.hpp"
+#include "mixbox_batch.hpp"
+#include "separation_file.hpp"
+#include "third-party/mixbox.h"
+#include <algorithm>
+#include <atomic>
+#include <execution>
+#include <numeric>
 #include <ranges>
 
 namespace r = std::ranges;
@@ -6,61 +13,711 @@ namespace rv = std::ranges::views;
 
 namespace {
 
-    ser::ink_separation separate_image(const QImage& img, const ser::color_lut& lut) {
+    // Rows between progress reports and cancellation checks
+    constexpr int ROWS_PER_REPORT = 32;
+
+    // Separation works on the separation's index tiles. A tile row of input
+    // is 1 KB, and each of its ink runs 2 KB of contiguous output.
+    constexpr int TILE_WIDTH = ser::ink_separation::TILE_WIDTH;
+    constexpr int TILE_HEIGHT = ser::ink_separation::TILE_HEIGHT;
+
+    // True if any of count coverage values is above COVERAGE_EPSILON
+    bool any_significant(const float* k, int count) {
+        float peak = 0.0f;
+        for (int x = 0; x < count; ++x) {
+            peak = std::max(peak, k[x]);
+        }
+        return peak > ser::COVERAGE_EPSILON;
+    }
+
+    template <typename LUT>
+    ser::ink_separation separate_with(const QImage& img, const LUT& lut, const ser::job_control& job,
+            ser::ink_format format) {
         int width = img.width();
         int height = img.height();
 
         // Determine the number of ink layers based on the palette size in the LUT
         // Each layer represents the coefficient k_i for a specific palette color[cite: 9, 36].
         size_t num_inks = lut.palette().size();
-        ser::ink_separation layers;
-        for (size_t i = 0; i < num_inks; ++i) {
-            layers.emplace_back(width, height);
+        ser::ink_separation layers(num_inks, width, height, format);
+
+        // Tiles run in parallel. Each row of a tile is read through
+        // constScanLine and goes through the LUT's batch lookup, straight
+        // into contiguous runs of the float planes, or through a tile row
+        // of scratch into the fixed-point ones. The inks a tile turns out
+        // to use are marked in the separation's tile index.
+        QImage rgb = img.convertToFormat(QImage::Format_RGB32);
+        const int tiles_x = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+        const int tiles_y = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+        std::vector<int> tiles(tiles_x * tiles_y);
+        std::iota(tiles.begin(), tiles.end(), 0);
+
+        const bool direct = (format == ser::ink_format::float32);
+        const int tiles_per_report = std::max(1, static_cast<int>(tiles.size()) / 100);
+        std::atomic<int> tiles_done = 0;
+        std::for_each(std::execution::par, tiles.begin(), tiles.end(), [&](int tile) {
+            if (job.stop_requested()) return;
+
+            int x0 = (tile % tiles_x) * TILE_WIDTH;
+            int y0 = (tile / tiles_x) * TILE_HEIGHT;
+            int count = std::min(TILE_WIDTH, width - x0);
+            int y1 = std::min(y0 + TILE_HEIGHT, height);
+
+            std::vector<float> scratch(direct ? 0 : num_inks * TILE_WIDTH);
+            std::vector<float*> out_rows(num_inks);
+            for (size_t i = 0; i < num_inks; ++i) {
+                out_rows[i] = scratch.data() + i * TILE_WIDTH;
+            }
+            std::vector<char> used(num_inks, 0);
+            for (int y = y0; y < y1; ++y) {
+                if (direct) {
+                    for (size_t i = 0; i < num_inks; ++i) {
+                        out_rows[i] = layers[i].row<float>(y) + x0;
+                    }
+                }
+                const QRgb* line = reinterpret_cast<const QRgb*>(rgb.constScanLine(y));
+                lut.look_up_row(line + x0, count, out_rows.data());
+                for (size_t i = 0; i < num_inks; ++i) {
+                    if (!used[i] && any_significant(out_rows[i], count)) used[i] = 1;
+                    if (!direct) layers[i].write_row(y, x0, count, out_rows[i]);
+                }
+            }
+            for (size_t i = 0; i < num_inks; ++i) {
+                if (used[i]) layers.mark_ink(tile, i);
+            }
+
+            int done = ++tiles_done;
+            if (done % tiles_per_report == 0) {
+                job.report(static_cast<double>(done) / tiles.size());
+            }
+            });
+
+        if (job.stop_requested()) return {};
+        return layers;
+    }
+
+    template <typename LUT>
+    QImage separate_and_reink_with(const QImage& img, const LUT& lut,
+            const std::vector<ser::latent_space_color>& target_palette, const ser::job_control& job,
+            ser::ink_separation* layers) {
+        int width = img.width();
+        int height = img.height();
+        size_t num_inks = lut.palette().size();
+        if (num_inks == 0 || target_palette.size() != num_inks) return QImage();
+        if (layers && (layers->size() != num_inks || layers->width() != width || layers->height() != height)) {
+            return QImage();
         }
+        QImage result(width, height, QImage::Format_RGB32);
+
+        // Tiles run in parallel, as in separate_with. A tile row goes from
+        // pixels to coverage to a mix of the target inks to RGB through one
+        // tile row of scratch per ink, which stays in cache; coverage only
+        // leaves it if layers are to be kept.
+        QImage rgb = img.convertToFormat(QImage::Format_RGB32);
+        uchar* bits = result.bits();
+        const qsizetype bytes_per_line = result.bytesPerLine();
+        const int tiles_x = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+        const int tiles_y = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+        std::vector<int> tiles(tiles_x * tiles_y);
+        std::iota(tiles.begin(), tiles.end(), 0);
+
+        const int tiles_per_report = std::max(1, static_cast<int>(tiles.size()) / 100);
+        std::atomic<int> tiles_done = 0;
+        std::for_each(std::execution::par, tiles.begin(), tiles.end(), [&](int tile) {
+            if (job.stop_requested()) return;
+
+            int x0 = (tile % tiles_x) * TILE_WIDTH;
+            int y0 = (tile / tiles_x) * TILE_HEIGHT;
+            int count = std::min(TILE_WIDTH, width - x0);
+            int y1 = std::min(y0 + TILE_HEIGHT, height);
 
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                auto k = lut.look_up(img.pixel(x, y));
+            std::vector<float> scratch(num_inks * TILE_WIDTH);
+            std::vector<float*> out_rows(num_inks);
+            for (size_t i = 0; i < num_inks; ++i) {
+                out_rows[i] = scratch.data() + i * TILE_WIDTH;
+            }
+            std::vector<float> mixed(MIXBOX_LATENT_SIZE * TILE_WIDTH);
+            float* latent[MIXBOX_LATENT_SIZE];
+            for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+                latent[d] = mixed.data() + d * TILE_WIDTH;
+            }
+            std::vector<char> used(num_inks, 0);
+            for (int y = y0; y < y1; ++y) {
+                const QRgb* line = reinterpret_cast<const QRgb*>(rgb.constScanLine(y));
+                lut.look_up_row(line + x0, count, out_rows.data());
+
+                std::fill(mixed.begin(), mixed.end(), 0.0f);
                 for (size_t i = 0; i < num_inks; ++i) {
-                    layers[i](x, y) = k[i];
+                    const float* coverage = out_rows[i];
+                    for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+                        const float weight = target_palette[i][d];
+                        for (int x = 0; x < count; ++x) {
+                            latent[d][x] += coverage[x] * weight;
+                        }
+                    }
+                    if (layers) {
+                        if (!used[i] && any_significant(coverage, count)) used[i] = 1;
+                        (*layers)[i].write_row(y, x0, count, coverage);
+                    }
                 }
+
+                QRgb* out = reinterpret_cast<QRgb*>(bits + y * bytes_per_line);
+                ser::mixbox_latent_to_rgb_row(latent, count, out + x0);
+            }
+            for (size_t i = 0; layers && i < num_inks; ++i) {
+                if (used[i]) layers->mark_ink(tile, i);
             }
+
+            int done = ++tiles_done;
+            if (done % tiles_per_report == 0) {
+                job.report(static_cast<double>(done) / tiles.size());
+            }
+            });
+
+        if (job.stop_requested()) return QImage();
+        return result;
+    }
+
+    // Distinct colors per parallel chunk of the unique-color lookups
+    constexpr int COLORS_PER_CHUNK = 256;
+
+    // Copies per-color elements of a plane's type to count pixels by index
+    template <typename T>
+    void scatter_row(const void* per_color, const uint16_t* index, int count, void* out) {
+        const T* src = static_cast<const T*>(per_color);
+        T* dst = static_cast<T*>(out);
+        for (int x = 0; x < count; ++x) {
+            dst[x] = src[index[x]];
         }
+    }
+
+    void scatter_row(ser::ink_format format, const void* per_color, const uint16_t* index, int count, void* out) {
+        switch (ser::element_size(format)) {
+        case 1:
+            scatter_row<uint8_t>(per_color, index, count, out);
+            break;
+        case 2:
+            scatter_row<uint16_t>(per_color, index, count, out);
+            break;
+        default:
+            scatter_row<uint32_t>(per_color, index, count, out);
+            break;
+        }
+    }
 
+    template <typename LUT>
+    ser::ink_separation separate_indexed(const ser::color_index& index, const LUT& lut, const ser::job_control& job,
+            ser::ink_format format) {
+        if (index.empty()) return {};
+
+        int width = index.width();
+        int height = index.height();
+        size_t num_inks = lut.palette().size();
+        ser::ink_separation layers(num_inks, width, height, format);
+        const auto& colors = index.colors();
+        const int num_colors = static_cast<int>(colors.size());
+
+        // 1. One lookup per color, in parallel chunks. The coverage goes into
+        // a one-row separation of the colors in the output's format, so that
+        // scattering copies elements as they are.
+        ser::ink_separation per_color(num_inks, num_colors, 1, format);
+        std::vector<char> significant(num_inks * num_colors);
+        std::vector<int> chunks((num_colors + COLORS_PER_CHUNK - 1) / COLORS_PER_CHUNK);
+        std::iota(chunks.begin(), chunks.end(), 0);
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](int chunk) {
+            if (job.stop_requested()) return;
+
+            int c0 = chunk * COLORS_PER_CHUNK;
+            int count = std::min(COLORS_PER_CHUNK, num_colors - c0);
+            std::vector<float> k(num_inks * COLORS_PER_CHUNK);
+            std::vector<float*> out_rows(num_inks);
+            for (size_t i = 0; i < num_inks; ++i) {
+                out_rows[i] = k.data() + i * COLORS_PER_CHUNK;
+            }
+            lut.look_up_row(colors.data() + c0, count, out_rows.data());
+            for (size_t i = 0; i < num_inks; ++i) {
+                per_color[i].write_row(0, c0, count, out_rows[i]);
+                for (int c = 0; c < count; ++c) {
+                    significant[i * num_colors + c0 + c] = (out_rows[i][c] > ser::COVERAGE_EPSILON);
+                }
+            }
+            });
+        if (job.stop_requested()) return {};
+        job.report(0.1);
+
+        // 2. Tiles scatter each ink's per-color row through the index rows in
+        // parallel. A tile uses an ink if any of its colors does.
+        const int tiles_x = layers.tiles_x();
+        std::vector<int> tiles(tiles_x * layers.tiles_y());
+        std::iota(tiles.begin(), tiles.end(), 0);
+        const int tiles_per_report = std::max(1, static_cast<int>(tiles.size()) / 100);
+        std::atomic<int> tiles_done = 0;
+        std::for_each(std::execution::par, tiles.begin(), tiles.end(), [&](int tile) {
+            if (job.stop_requested()) return;
+
+            int x0 = (tile % tiles_x) * TILE_WIDTH;
+            int y0 = (tile / tiles_x) * TILE_HEIGHT;
+            int count = std::min(TILE_WIDTH, width - x0);
+            int y1 = std::min(y0 + TILE_HEIGHT, height);
+            const size_t bytes = ser::element_size(format);
+
+            for (size_t i = 0; i < num_inks; ++i) {
+                const void* src = per_color[i].row_data(0);
+                for (int y = y0; y < y1; ++y) {
+                    void* dst = static_cast<std::byte*>(layers[i].row_data(y)) + x0 * bytes;
+                    scatter_row(format, src, index.row(y) + x0, count, dst);
+                }
+            }
+
+            std::vector<char> in_tile(num_colors, 0);
+            std::vector<uint16_t> tile_colors;
+            for (int y = y0; y < y1; ++y) {
+                const uint16_t* row = index.row(y) + x0;
+                for (int x = 0; x < count; ++x) {
+                    if (in_tile[row[x]]) continue;
+                    in_tile[row[x]] = 1;
+                    tile_colors.push_back(row[x]);
+                }
+            }
+            for (size_t i = 0; i < num_inks; ++i) {
+                const char* ink_significant = significant.data() + i * num_colors;
+                if (r::any_of(tile_colors, [&](uint16_t c) { return ink_significant[c] != 0; })) {
+                    layers.mark_ink(tile, i);
+                }
+            }
+
+            int done = ++tiles_done;
+            if (done % tiles_per_report == 0) {
+                job.report(0.1 + 0.9 * done / tiles.size());
+            }
+            });
+
+        if (job.stop_requested()) return {};
         return layers;
     }
 }
 
+ser::ink_separation ser::separate_image(const QImage& img, const color_lut& lut, const job_control& job,
+        ink_format format) {
+    return separate_with(img, lut, job, format);
+}
+
+ser::ink_separation ser::separate_image(const QImage& img, const octree_lut& lut, const job_control& job,
+        ink_format format) {
+    return separate_with(img, lut, job, format);
+}
+
+ser::ink_separation ser::separate_image(const color_index& index, const color_lut& lut, const job_control& job,
+        ink_format format) {
+    return separate_indexed(index, lut, job, format);
+}
+
+ser::ink_separation ser::separate_image(const color_index& index, const octree_lut& lut, const job_control& job,
+        ink_format format) {
+    return separate_indexed(index, lut, job, format);
+}
+
+ser::ink_separation ser::separate_image(const color_index& index, exact_solution_cache& cache, const job_control& job,
+        ink_format format) {
+    if (index.empty()) return {};
+    if (cache.solve(index.colors(), job.step(0.0, 0.5)) < 0) return {};
+    return separate_indexed(index, cache, job.step(0.5, 1.0), format);
+}
+
 std::tuple<ser::ink_separation, ser::color_lut> ser::separate_image(const QImage& img, const std::vector<QColor>& palette) {
-    auto lut = color_lut( palette );
-    auto sep = ::separate_image(img, lut);
+    // Only the lattice cells this image touches need solving
+    auto lut = color_lut( palette, img );
+    auto sep = separate_image(img, lut);
     return { sep, lut };
 }
 
-QImage ser::ink_layers_to_image(const ink_separation& layers, const std::vector<latent_space_color>& palette) {
+QImage ser::ink_layers_to_image(const ink_separation& layers, const std::vector<latent_space_color>& palette,
+        const job_control& job) {
     if (layers.empty()) return QImage();
 
-    int width = layers[0].width();  // Assuming accessors for ink_layer dimensions
-    int height = layers[0].height();
+    int width = layers.width();
+    int height = layers.height();
     QImage result(width, height, QImage::Format_RGB32);
 
-    for (int y = 0; y < height; ++y) {
+    // Rows run in parallel; each reads its ink rows back as float coverage,
+    // mixes them into a row of latent colors and converts that straight
+    // into its scan line. bits() is taken up front so that no worker can
+    // trigger a detach.
+    uchar* bits = result.bits();
+    const qsizetype bytes_per_line = result.bytesPerLine();
+    if (palette.size() != layers.size()) {
+        result.fill(Qt::black);
+        return result;
+    }
+    std::vector<int> rows(height);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::atomic<int> rows_done = 0;
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y) {
+        if (job.stop_requested()) return;
+
+        std::vector<float> coverage(width);
+        std::vector<float> mixed(MIXBOX_LATENT_SIZE * width, 0.0f);
+        float* latent[MIXBOX_LATENT_SIZE];
+        for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+            latent[d] = mixed.data() + d * width;
+        }
+        for (size_t i = 0; i < layers.size(); ++i) {
+            layers[i].read_row(y, coverage.data());
+            for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+                const float weight = palette[i][d];
+                for (int x = 0; x < width; ++x) {
+                    latent[d][x] += coverage[x] * weight;
+                }
+            }
+        }
+
+        QRgb* line = reinterpret_cast<QRgb*>(bits + y * bytes_per_line);
+        mixbox_latent_to_rgb_row(latent, width, line);
+
+        int done = ++rows_done;
+        if (done % ROWS_PER_REPORT == 0) {
+            job.report(static_cast<double>(done) / height);
+        }
+        });
+
+    if (job.stop_requested()) return QImage();
+    return result;
+}
+
+QImage ser::ink_layers_to_image(const ink_separation& layers, const std::vector<QColor>& palette,
+        const job_control& job) {
+    auto latent_space_palette = to_latent_space(palette);
+    return ink_layers_to_image(layers, latent_space_palette, job);
+}
+
+QImage ser::separate_and_reink(const QImage& img, const color_lut& lut,
+        const std::vector<latent_space_color>& target_palette, const job_control& job, ink_separation* layers) {
+    return separate_and_reink_with(img, lut, target_palette, job, layers);
+}
+
+QImage ser::separate_and_reink(const QImage& img, const octree_lut& lut,
+        const std::vector<latent_space_color>& target_palette, const job_control& job, ink_separation* layers) {
+    return separate_and_reink_with(img, lut, target_palette, job, layers);
+}
+
+QImage ser::separate_and_reink(const QImage& img, const color_lut& lut, const std::vector<QColor>& target_palette,
+        const job_control& job, ink_separation* layers) {
+    auto latent_space_palette = to_latent_space(target_palette);
+    return separate_and_reink_with(img, lut, latent_space_palette, job, layers);
+}
+
+QImage ser::ink_layers_to_image(const ink_separation& layers, const color_index& index,
+        const std::vector<latent_space_color>& palette, const job_control& job) {
+    if (layers.empty() || index.empty()) return QImage();
+    if (layers.width() != index.width() || layers.height() != index.height()) return QImage();
+
+    int width = layers.width();
+    int height = layers.height();
+    QImage result(width, height, QImage::Format_RGB32);
+    if (palette.size() != layers.size()) {
+        result.fill(Qt::black);
+        return result;
+    }
+
+    // 1. Every pixel of a color has the same coverage, so each color is
+    // mixed once from its coverage at the pixel where it first appears
+    const int num_colors = static_cast<int>(index.size());
+    std::vector<float> mixed(MIXBOX_LATENT_SIZE * num_colors, 0.0f);
+    float* latent[MIXBOX_LATENT_SIZE];
+    for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+        latent[d] = mixed.data() + d * num_colors;
+    }
+    for (size_t i = 0; i < layers.size(); ++i) {
+        for (int c = 0; c < num_colors; ++c) {
+            const float k = static_cast<float>(layers[i](index.first_x(c), index.first_y(c)));
+            for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+                latent[d][c] += k * palette[i][d];
+            }
+        }
+    }
+    std::vector<QRgb> mixed_rgb(num_colors);
+    mixbox_latent_to_rgb_row(latent, num_colors, mixed_rgb.data());
+
+    // 2. Rows scatter the mixed colors through the index in parallel
+    uchar* bits = result.bits();
+    const qsizetype bytes_per_line = result.bytesPerLine();
+    std::vector<int> rows(height);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::atomic<int> rows_done = 0;
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y) {
+        if (job.stop_requested()) return;
+
+        QRgb* line = reinterpret_cast<QRgb*>(bits + y * bytes_per_line);
+        scatter_row<QRgb>(mixed_rgb.data(), index.row(y), width, line);
+
+        int done = ++rows_done;
+        if (done % ROWS_PER_REPORT == 0) {
+            job.report(static_cast<double>(done) / height);
+        }
+        });
+
+    if (job.stop_requested()) return QImage();
+    return result;
+}
+
+QImage ser::ink_layers_to_image(const ink_separation& layers, const color_index& index,
+        const std::vector<QColor>& palette, const job_control& job) {
+    auto latent_space_palette = to_latent_space(palette);
+    return ink_layers_to_image(layers, index, latent_space_palette, job);
+}
+
+QImage ser::reink_image(const QImage& img, const reink_lut& lut, const job_control& job) {
+    if (lut.empty()) return QImage();
+
+    QImage rgb = img.convertToFormat(QImage::Format_RGB32);
+    QImage result(rgb.width(), rgb.height(), QImage::Format_RGB32);
+
+    // Blocks of rows run in parallel, straight from scan line to scan line
+    uchar* bits = result.bits();
+    const qsizetype bytes_per_line = result.bytesPerLine();
+    const int height = rgb.height();
+    std::vector<int> blocks((height + ROWS_PER_REPORT - 1) / ROWS_PER_REPORT);
+    std::iota(blocks.begin(), blocks.end(), 0);
+    std::atomic<int> blocks_done = 0;
+    std::for_each(std::execution::par, blocks.begin(), blocks.end(), [&](int block) {
+        if (job.stop_requested()) return;
+
+        int y1 = std::min((block + 1) * ROWS_PER_REPORT, height);
+        for (int y = block * ROWS_PER_REPORT; y < y1; ++y) {
+            const QRgb* in = reinterpret_cast<const QRgb*>(rgb.constScanLine(y));
+            QRgb* out = reinterpret_cast<QRgb*>(bits + y * bytes_per_line);
+            lut.look_up_row(in, rgb.width(), out);
+        }
+        job.report(static_cast<double>(++blocks_done) / blocks.size());
+        });
+
+    if (job.stop_requested()) return QImage();
+    return result;
+}
+
+int ser::reink_tiles(QImage& reinked, const QImage& img, const reink_lut& lut, const job_control& job) {
+    if (lut.empty()) return -1;
+    if (reinked.width() != img.width() || reinked.height() != img.height()) return -1;
+
+    // Only tiles holding a color whose cell the update touched are looked
+    // up again. They are redone whole, with the row offsets reink_image
+    // uses, so every pixel comes out of the same kernel path as there.
+    // The tiles are disjoint, so they are patched in parallel.
+    QImage rgb = img.convertToFormat(QImage::Format_RGB32);
+    uchar* bits = reinked.bits();
+    const qsizetype bytes_per_line = reinked.bytesPerLine();
+    const int width = rgb.width();
+    const int height = rgb.height();
+    const int tiles_x = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    const int tiles_y = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    std::vector<int> tiles(static_cast<size_t>(tiles_x) * tiles_y);
+    std::iota(tiles.begin(), tiles.end(), 0);
+    std::atomic<int> tiles_done = 0;
+    std::atomic<int> tiles_redone = 0;
+    std::for_each(std::execution::par, tiles.begin(), tiles.end(), [&](int tile) {
+        if (job.stop_requested()) return;
+
+        int x0 = (tile % tiles_x) * TILE_WIDTH;
+        int y0 = (tile / tiles_x) * TILE_HEIGHT;
+        int count = std::min(TILE_WIDTH, width - x0);
+        int y1 = std::min(y0 + TILE_HEIGHT, height);
+        bool changed = false;
+        for (int y = y0; y < y1 && !changed; ++y) {
+            const QRgb* in = reinterpret_cast<const QRgb*>(rgb.constScanLine(y)) + x0;
+            changed = std::any_of(in, in + count, [&](QRgb c) { return lut.changed(c); });
+        }
+        if (changed) {
+            for (int y = y0; y < y1; ++y) {
+                const QRgb* in = reinterpret_cast<const QRgb*>(rgb.constScanLine(y));
+                QRgb* out = reinterpret_cast<QRgb*>(bits + y * bytes_per_line);
+                lut.look_up_row(in + x0, count, out + x0);
+            }
+            ++tiles_redone;
+        }
+        job.report(static_cast<double>(++tiles_done) / tiles.size());
+        });
+
+    if (job.stop_requested()) return -1;
+    return tiles_redone;
+}
+
+bool ser::read_separation(const separation_file& file, ink_separation& layers, QImage& separated,
+        QImage& reinked, const job_control& job) {
+    const int width = file.width();
+    const int height = file.height();
+    const size_t num_inks = file.size();
+    layers = ink_separation(num_inks, width, height, file.format());
+    separated = QImage(width, height, QImage::Format_RGB32);
+    reinked = QImage(width, height, QImage::Format_RGB32);
+
+    // Tiles run in parallel. Each is decoded into the new, zeroed layers,
+    // then every row of it is read back once as float coverage and mixed
+    // into a row of latent colors per palette, in the same order as
+    // ink_layers_to_image.
+    const std::vector<latent_space_color> palettes[2] = {
+        to_latent_space(file.palette()), to_latent_space(file.target_palette()) };
+    uchar* bits[2] = { separated.bits(), reinked.bits() };
+    const qsizetype bytes_per_line = separated.bytesPerLine();
+    const int tiles_x = layers.tiles_x();
+    std::vector<int> tiles(static_cast<size_t>(tiles_x) * layers.tiles_y());
+    std::iota(tiles.begin(), tiles.end(), 0);
+
+    const int tiles_per_report = std::max(1, static_cast<int>(tiles.size()) / 100);
+    std::atomic<int> tiles_done = 0;
+    std::atomic<bool> corrupt = false;
+    std::for_each(std::execution::par, tiles.begin(), tiles.end(), [&](int tile) {
+        if (corrupt || job.stop_requested()) return;
+        if (file.read_tiles(std::span(&tile, 1), layers, {}, true) < 0) {
+            corrupt = true;
+            return;
+        }
+
+        int x0 = (tile % tiles_x) * TILE_WIDTH;
+        int y0 = (tile / tiles_x) * TILE_HEIGHT;
+        int count = std::min(TILE_WIDTH, width - x0);
+        int y1 = std::min(y0 + TILE_HEIGHT, height);
+
+        // An ink that is zero throughout the tile would add nothing
+        std::vector<size_t> inks;
+        for (size_t i = 0; i < num_inks; ++i) {
+            if (file.has_coverage(tile, i)) inks.push_back(i);
+        }
+
+        std::vector<float> coverage(TILE_WIDTH);
+        std::vector<float> mixed(2 * MIXBOX_LATENT_SIZE * TILE_WIDTH);
+        float* latent[2][MIXBOX_LATENT_SIZE];
+        for (int p = 0; p < 2; ++p) {
+            for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+                latent[p][d] = mixed.data() + (p * MIXBOX_LATENT_SIZE + d) * TILE_WIDTH;
+            }
+        }
+        for (int y = y0; y < y1; ++y) {
+            std::fill(mixed.begin(), mixed.end(), 0.0f);
+            for (size_t i : inks) {
+                layers[i].read_row(y, x0, count, coverage.data());
+                for (int p = 0; p < 2; ++p) {
+                    for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+                        const float weight = palettes[p][i][d];
+                        for (int x = 0; x < count; ++x) {
+                            latent[p][d][x] += coverage[x] * weight;
+                        }
+                    }
+                }
+            }
+            for (int p = 0; p < 2; ++p) {
+                QRgb* out = reinterpret_cast<QRgb*>(bits[p] + y * bytes_per_line);
+                mixbox_latent_to_rgb_row(latent[p], count, out + x0);
+            }
+        }
+
+        int done = ++tiles_done;
+        if (done % tiles_per_report == 0) {
+            job.report(static_cast<double>(done) / tiles.size());
+        }
+        });
+
+    if (corrupt || job.stop_requested()) {
+        layers = ink_separation();
+        return false;
+    }
+    return true;
+}
+
+ser::sparse_separation ser::separate_image(const QImage& img, const sparse_lut& lut, const job_control& job) {
+    int width = img.width();
+    int height = img.height();
+    const int k = lut.k();
+    sparse_separation layers(lut.palette().size(), k, width, height);
+    if (k == 0) return layers;
+
+    // Rows run in parallel, one lookup per pixel scattered into the K slot
+    // planes of the row
+    QImage rgb = img.convertToFormat(QImage::Format_RGB32);
+    std::vector<int> rows(height);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::atomic<int> rows_done = 0;
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y) {
+        if (job.stop_requested()) return;
+
+        std::vector<uint8_t> inks(k);
+        std::vector<float> weights(k);
+        std::vector<float> row_weights(static_cast<size_t>(k) * width);
+        const QRgb* line = reinterpret_cast<const QRgb*>(rgb.constScanLine(y));
         for (int x = 0; x < width; ++x) {
-            coefficients k;
-            k.reserve(layers.size());
-            for (const auto& layer : layers) {
-                k.push_back(layer(x, y));
+            lut.look_up(line[x], inks, weights);
+            for (int j = 0; j < k; ++j) {
+                layers.ink_row(j, y)[x] = inks[j];
+                row_weights[j * width + x] = weights[j];
             }
+        }
+        for (int j = 0; j < k; ++j) {
+            layers.write_weights(j, y, row_weights.data() + j * width);
+        }
 
-            auto color = color_from_ink_levels(k, palette);
-            result.setPixelColor(x, y, color);
+        int done = ++rows_done;
+        if (done % ROWS_PER_REPORT == 0) {
+            job.report(static_cast<double>(done) / height);
         }
+        });
+
+    if (job.stop_requested()) return {};
+    return layers;
+}
+
+QImage ser::ink_layers_to_image(const sparse_separation& layers, const std::vector<latent_space_color>& palette,
+        const job_control& job) {
+    if (layers.empty()) return QImage();
+
+    int width = layers.width();
+    int height = layers.height();
+    QImage result(width, height, QImage::Format_RGB32);
+
+    // As for dense layers, but each pixel mixes only its K palette entries
+    uchar* bits = result.bits();
+    const qsizetype bytes_per_line = result.bytesPerLine();
+    if (palette.size() != layers.inks()) {
+        result.fill(Qt::black);
+        return result;
     }
+    std::vector<int> rows(height);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::atomic<int> rows_done = 0;
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int y) {
+        if (job.stop_requested()) return;
 
+        const int k = layers.k();
+        std::vector<float> weights(static_cast<size_t>(k) * width);
+        for (int j = 0; j < k; ++j) {
+            layers.read_weights(j, y, weights.data() + j * width);
+        }
+
+        QRgb* line = reinterpret_cast<QRgb*>(bits + y * bytes_per_line);
+        for (int x = 0; x < width; ++x) {
+            mixbox_latent mixed = { 0 };
+            for (int j = 0; j < k; ++j) {
+                float w = weights[j * width + x];
+                const latent_space_color& ink = palette[layers.ink_row(j, y)[x]];
+                for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+                    mixed[d] += w * ink[d];
+                }
+            }
+            unsigned char r, g, b;
+            mixbox_latent_to_rgb(mixed, &r, &g, &b);
+            line[x] = qRgb(r, g, b);
+        }
+
+        int done = ++rows_done;
+        if (done % ROWS_PER_REPORT == 0) {
+            job.report(static_cast<double>(done) / height);
+        }
+        });
+
+    if (job.stop_requested()) return QImage();
     return result;
 }
 
-QImage ser::ink_layers_to_image(const ink_separation& layers, const std::vector<QColor>& palette) {
+QImage ser::ink_layers_to_image(const sparse_separation& layers, const std::vector<QColor>& palette,
+        const job_control& job) {
     auto latent_space_palette = to_latent_space(palette);
-    return ink_layers_to_image(layers, latent_space_palette);
-}
\ No newline at end of file
+    return ink_layers_to_image(layers, latent_space_palette, job);
+}
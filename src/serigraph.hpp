@@ -1,13 +1,92 @@
 #include "color_lut.hpp"
+#include "color_index.hpp"
+#include "octree_lut.hpp"
+#include "sparse_lut.hpp"
+#include "reink_lut.hpp"
+#include "solution_cache.hpp"
 #include "ink_layer.hpp"
+#include "job_control.hpp"
 #include <QImage>
 #include <QColor>
 #include <tuple>
 
 namespace ser {
 
+    class separation_file;
+
     std::tuple<ink_separation, color_lut> separate_image(const QImage& img, const std::vector<QColor>& palette);
-    QImage ink_layers_to_image(const ink_separation& layers, const std::vector<latent_space_color>& palette);
-    QImage ink_layers_to_image(const ink_separation& layers, const std::vector<QColor>& palette);
+
+    // These report progress through job and return an empty separation or
+    // a null image if it is cancelled. Separations are stored as uint16
+    // fixed point unless another format is asked for.
+    ink_separation separate_image(const QImage& img, const color_lut& lut, const job_control& job = {},
+        ink_format format = ink_format::uint16);
+    ink_separation separate_image(const QImage& img, const octree_lut& lut, const job_control& job = {},
+        ink_format format = ink_format::uint16);
+    QImage ink_layers_to_image(const ink_separation& layers, const std::vector<latent_space_color>& palette,
+        const job_control& job = {});
+    QImage ink_layers_to_image(const ink_separation& layers, const std::vector<QColor>& palette,
+        const job_control& job = {});
+
+    // Separation and compositing in one pass, tile by tile, for when the
+    // image is all that is wanted: each ink's coverage lives only in a tile
+    // row of scratch, so memory use beyond the result does not grow with
+    // the palette. Gives the image of ink_layers_to_image on a float32
+    // separation. If layers is given, which must match img and the
+    // palette in size, the separation is stored there too, index included.
+    // Returns a null image on a mismatch or if cancelled.
+    QImage separate_and_reink(const QImage& img, const color_lut& lut,
+        const std::vector<latent_space_color>& target_palette, const job_control& job = {},
+        ink_separation* layers = nullptr);
+    QImage separate_and_reink(const QImage& img, const octree_lut& lut,
+        const std::vector<latent_space_color>& target_palette, const job_control& job = {},
+        ink_separation* layers = nullptr);
+    QImage separate_and_reink(const QImage& img, const color_lut& lut, const std::vector<QColor>& target_palette,
+        const job_control& job = {}, ink_separation* layers = nullptr);
+
+    // Unique-color counterparts: the LUT is looked up, or the inks mixed,
+    // once per color of index and the results scattered to the pixels.
+    // layers must be a separation of the indexed image.
+    ink_separation separate_image(const color_index& index, const color_lut& lut, const job_control& job = {},
+        ink_format format = ink_format::uint16);
+    ink_separation separate_image(const color_index& index, const octree_lut& lut, const job_control& job = {},
+        ink_format format = ink_format::uint16);
+    QImage ink_layers_to_image(const ink_separation& layers, const color_index& index,
+        const std::vector<latent_space_color>& palette, const job_control& job = {});
+
+    // Exact separation of an indexed image: the colors of index that cache
+    // does not have yet are solved first and added to it
+    ink_separation separate_image(const color_index& index, exact_solution_cache& cache, const job_control& job = {},
+        ink_format format = ink_format::uint16);
+    QImage ink_layers_to_image(const ink_separation& layers, const color_index& index,
+        const std::vector<QColor>& palette, const job_control& job = {});
+
+    // Re-inks the source image directly, one lookup per pixel. Returns a
+    // null image for an empty LUT or if cancelled.
+    QImage reink_image(const QImage& img, const reink_lut& lut, const job_control& job = {});
+
+    // Delta re-ink after reink_lut::update_ink: patches, in place, only the
+    // tiles of reinked, the re-ink of img before the update, that hold a
+    // color the update changed. The result is the same as reink_image with
+    // the updated table. Returns the number of tiles redone, or -1 if
+    // reinked does not match img or the job is cancelled, in which case
+    // reinked needs a full re-ink.
+    int reink_tiles(QImage& reinked, const QImage& img, const reink_lut& lut, const job_control& job = {});
+
+    // Decodes a saved separation into layers and composites it on the way,
+    // with the file's inks into separated and its target inks into reinked.
+    // Each tile is mixed with both palettes as soon as it is decoded, while
+    // it is still in cache, and inks whose chunk of the tile is all zero
+    // are left out of its mix; the images are those of ink_layers_to_image
+    // all the same. Returns false if cancelled or a chunk is corrupt.
+    bool read_separation(const separation_file& file, ink_separation& layers, QImage& separated,
+        QImage& reinked, const job_control& job = {});
+
+    // Sparse counterparts; both cost O(K) per pixel whatever the palette size
+    sparse_separation separate_image(const QImage& img, const sparse_lut& lut, const job_control& job = {});
+    QImage ink_layers_to_image(const sparse_separation& layers, const std::vector<latent_space_color>& palette,
+        const job_control& job = {});
+    QImage ink_layers_to_image(const sparse_separation& layers, const std::vector<QColor>& palette,
+        const job_control& job = {});
 
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+// Vectorized kernels live in translation units of their own, the only
+// ones built with their instruction set's flags (see CMakeLists.txt), so
+// the rest of the program runs on any x86-64 CPU and its floating-point
+// results do not depend on the build options. The build defines
+// SERIGRAPH_BUILD_AVX2 / SERIGRAPH_BUILD_AVX512 when it compiles those
+// units; callers check both that and cpu_has_avx2() / cpu_has_avx512()
+// before calling into them.
+
+#ifndef SERIGRAPH_BUILD_AVX2
+#define SERIGRAPH_BUILD_AVX2 0
+#endif
+
+#ifndef SERIGRAPH_BUILD_AVX512
+#define SERIGRAPH_BUILD_AVX512 0
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace ser {
+
+    // True if the CPU and OS support AVX2 with FMA
+    inline bool cpu_has_avx2() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        static const bool has = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return has;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        static const bool has = []() {
+            int info[4];
+            __cpuidex(info, 1, 0);
+            const bool fma = (info[2] & (1 << 12)) != 0;
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            if (!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+            }();
+        return has;
+#else
+        return false;
+#endif
+    }
+
+    // True if the CPU and OS support AVX-512F, on top of cpu_has_avx2()
+    inline bool cpu_has_avx512() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        static const bool has = cpu_has_avx2() && __builtin_cpu_supports("avx512f");
+        return has;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        static const bool has = []() {
+            if (!cpu_has_avx2() || (_xgetbv(0) & 0xE6) != 0xE6) return false;
+            int info[4];
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 16)) != 0;
+            }();
+        return has;
+#else
+        return false;
+#endif
+    }
+
+}
@@ -0,0 +1,217 @@
+#include "solution_cache.hpp"
+#include "qp_solver.hpp"
+#include "lut_cache.hpp"
+#include "third-party/mixbox.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <execution>
+#include <numeric>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+
+namespace {
+
+    // Most colors a cache keeps; past it the colors least recently asked
+    // for are dropped. 8 inks take 36 bytes a color, so about 9 MB.
+    constexpr size_t MAX_STORED_COLORS = 262144;
+
+    // Colors per parallel task; each is warm-started from the one before
+    constexpr int COLORS_PER_TASK = 64;
+
+    uint32_t opaque(QRgb color) {
+        return color | 0xff000000u;
+    }
+
+    // Solution files share the LUT key, with grid size 0 for "no lattice"
+    ser::lut_key cache_key(const std::vector<QColor>& palette) {
+        return { palette, 0, ser::color_lut::lambda(), ser::SOLVER_VERSION };
+    }
+
+    ser::latent_space_color color_target(QRgb color) {
+        mixbox_latent latent_arr;
+        mixbox_rgb_to_latent(qRed(color), qGreen(color), qBlue(color), latent_arr);
+        ser::latent_space_color target;
+        std::copy(std::begin(latent_arr), std::end(latent_arr), target.begin());
+        return target;
+    }
+}
+
+// -------------------------------------------------------------------------
+// ser::exact_solution_cache Implementation
+// -------------------------------------------------------------------------
+
+ser::exact_solution_cache::exact_solution_cache(const std::vector<QColor>& palette) :
+        source_palette_(palette), palette_(to_latent_space(palette)) {
+    if (palette.empty()) return;
+    solver_ = std::make_shared<const qp_solver>(palette_, color_lut::lambda());
+
+    lut_key key = cache_key(source_palette_);
+    if (read_solution_file(solution_cache_path(key), key, colors_, values_)) {
+        for (size_t i = 0; i < colors_.size(); ++i) {
+            slots_.emplace(colors_[i], static_cast<uint32_t>(i));
+        }
+        last_use_.assign(colors_.size(), 0);
+    }
+}
+
+void ser::exact_solution_cache::evict(size_t in_use) {
+    const size_t keep = std::max(MAX_STORED_COLORS, in_use);
+    if (colors_.size() <= keep) return;
+
+    // 1. Keep the most recently used entries, oldest first, so that the
+    // order carries the recency into the file and the next run
+    std::vector<uint32_t> order(colors_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return last_use_[a] < last_use_[b];
+        });
+    order.erase(order.begin(), order.end() - keep);
+
+    // 2. Gather the kept entries and index them again
+    const size_t n = palette_.size();
+    std::vector<QRgb> colors(order.size());
+    std::vector<float> values(order.size() * n);
+    std::vector<uint32_t> last_use(order.size());
+    slots_.clear();
+    for (size_t i = 0; i < order.size(); ++i) {
+        colors[i] = colors_[order[i]];
+        std::copy_n(values_.begin() + static_cast<size_t>(order[i]) * n, n, values.begin() + i * n);
+        last_use[i] = last_use_[order[i]];
+        slots_.emplace(colors[i], static_cast<uint32_t>(i));
+    }
+    colors_ = std::move(colors);
+    values_ = std::move(values);
+    last_use_ = std::move(last_use);
+    modified_ = true;
+}
+
+int ser::exact_solution_cache::solve(std::span<const QRgb> colors, const job_control& job) {
+    if (!solver_) return 0;
+
+    // 1. Colors not cached yet, once each. The cached ones are marked as
+    // used by this call.
+    ++uses_;
+    std::vector<QRgb> missing;
+    size_t cached = 0;
+    for (QRgb color : colors) {
+        auto it = slots_.find(opaque(color));
+        if (it == slots_.end()) missing.push_back(opaque(color));
+        else if (last_use_[it->second] != uses_) {
+            last_use_[it->second] = uses_;
+            ++cached;
+        }
+    }
+    std::sort(missing.begin(), missing.end());
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+    if (missing.empty()) return 0;
+
+    // 2. Solve in parallel into entries appended past the cached ones. In
+    // sorted order neighbouring colors mostly share their active set, so
+    // each warm-starts the next.
+    const size_t n = palette_.size();
+    const size_t first = colors_.size();
+    std::vector<float> solved(missing.size() * n);
+    std::vector<int> tasks((missing.size() + COLORS_PER_TASK - 1) / COLORS_PER_TASK);
+    std::iota(tasks.begin(), tasks.end(), 0);
+    std::atomic<int> tasks_done = 0;
+    std::for_each(std::execution::par, tasks.begin(), tasks.end(), [&](int task) {
+        if (job.stop_requested()) return;
+
+        size_t begin = static_cast<size_t>(task) * COLORS_PER_TASK;
+        size_t end = std::min(begin + COLORS_PER_TASK, missing.size());
+        coefficients k(n);
+        coefficients prev;
+        for (size_t c = begin; c < end; ++c) {
+            solver_->solve(color_target(missing[c]), k, prev);
+            std::copy(k.begin(), k.end(), solved.begin() + c * n);
+            prev = k;
+        }
+        job.report(static_cast<double>(++tasks_done) / tasks.size());
+        });
+    if (job.stop_requested()) return -1;
+
+    colors_.insert(colors_.end(), missing.begin(), missing.end());
+    values_.insert(values_.end(), solved.begin(), solved.end());
+    last_use_.resize(colors_.size(), uses_);
+    for (size_t c = 0; c < missing.size(); ++c) {
+        slots_.emplace(missing[c], static_cast<uint32_t>(first + c));
+    }
+    modified_ = true;
+
+    // 3. The colors asked for stay cached, even past the cap
+    evict(cached + missing.size());
+    return static_cast<int>(missing.size());
+}
+
+void ser::exact_solution_cache::look_up(QRgb color, std::span<float> k) const {
+    auto it = slots_.find(opaque(color));
+    if (it == slots_.end()) {
+        std::fill(k.begin(), k.end(), 0.0f);
+        return;
+    }
+    const float* values = values_.data() + static_cast<size_t>(it->second) * palette_.size();
+    std::copy(values, values + palette_.size(), k.begin());
+}
+
+void ser::exact_solution_cache::look_up_row(const QRgb* pixels, int count, float* const* out_rows) const {
+    const size_t n = palette_.size();
+    for (int x = 0; x < count; ++x) {
+        auto it = slots_.find(opaque(pixels[x]));
+        const float* values = (it == slots_.end()) ? nullptr : values_.data() + static_cast<size_t>(it->second) * n;
+        for (size_t i = 0; i < n; ++i) {
+            out_rows[i][x] = values ? values[i] : 0.0f;
+        }
+    }
+}
+
+double ser::exact_solution_cache::max_difference(const color_lut& lut, std::span<const QRgb> colors) const {
+    if (lut.palette().size() != palette_.size()) return 0.0;
+
+    const size_t n = palette_.size();
+    std::vector<float> k(n);
+    double max_diff = 0.0;
+    for (QRgb color : colors) {
+        auto it = slots_.find(opaque(color));
+        if (it == slots_.end()) continue;
+
+        lut.look_up(QColor(color), k);
+        const float* values = values_.data() + static_cast<size_t>(it->second) * n;
+        for (size_t i = 0; i < n; ++i) {
+            max_diff = std::max(max_diff, static_cast<double>(std::abs(k[i] - values[i])));
+        }
+    }
+    return max_diff;
+}
+
+bool ser::exact_solution_cache::save() {
+    if (!modified_) return true;
+
+    lut_key key = cache_key(source_palette_);
+    if (!write_solution_file(solution_cache_path(key), key, colors_, values_)) return false;
+    modified_ = false;
+    return true;
+}
+
+size_t ser::exact_solution_cache::size() const {
+    return colors_.size();
+}
+
+bool ser::exact_solution_cache::empty() const {
+    return colors_.empty();
+}
+
+size_t ser::exact_solution_cache::memory_usage() const {
+    return colors_.size() * (sizeof(QRgb) + palette_.size() * sizeof(float)) +
+        slots_.size() * (sizeof(QRgb) + sizeof(uint32_t) + 2 * sizeof(void*));
+}
+
+const std::vector<ser::latent_space_color>& ser::exact_solution_cache::palette() const {
+    return palette_;
+}
+
+const std::vector<QColor>& ser::exact_solution_cache::source_palette() const {
+    return source_palette_;
+}
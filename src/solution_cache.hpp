@@ -0,0 +1,73 @@
+#pragma once
+
+#include "color_lut.hpp"
+#include "job_control.hpp"
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include <QColor>
+
+namespace ser {
+
+    class qp_solver;
+
+    // Exact separations of individual colors: the ink QP solved for the
+    // color itself instead of interpolated from the lattice, which rounds
+    // off the kinks where the set of inks in use changes. Meant for the
+    // distinct colors of a color_index; a few thousand colors solve in
+    // tens of milliseconds.
+    //
+    // Solutions are kept per palette, in memory and in a file beside the
+    // baked LUTs (solution_cache_path), so colors solved in one run are
+    // free in the next. Each solution depends only on its color, the
+    // palette and lambda, so cached and fresh ones are interchangeable.
+    // The cache is capped in size, in memory as in the file; the colors
+    // least recently asked for are the ones dropped from it.
+    class exact_solution_cache {
+
+        std::vector<QColor> source_palette_;
+        std::vector<latent_space_color> palette_;
+        std::shared_ptr<const qp_solver> solver_;
+        std::unordered_map<QRgb, uint32_t> slots_; // opaque color -> entry
+        std::vector<QRgb> colors_;
+        std::vector<float> values_;                // palette size floats per entry
+        std::vector<uint32_t> last_use_;           // per entry: the solve() call that last asked for it
+        uint32_t uses_ = 0;                        // solve() calls so far
+        bool modified_ = false;                    // entries differ from the file
+
+        void evict(size_t in_use);
+
+    public:
+
+        exact_solution_cache() {}
+
+        // Starts from the solutions on disk for palette, if any
+        explicit exact_solution_cache(const std::vector<QColor>& palette);
+
+        // Solves the colors not cached yet, in parallel. Returns the number
+        // solved, or -1 if cancelled, in which case none are added. Past the
+        // cap, the least recently used colors not among colors are dropped.
+        int solve(std::span<const QRgb> colors, const job_control& job = {});
+
+        // Same interface as the LUTs, for cached colors; colors never
+        // solved come out as zero coverage
+        void look_up(QRgb color, std::span<float> k) const;
+        void look_up_row(const QRgb* pixels, int count, float* const* out_rows) const;
+
+        // Largest difference of any coefficient between lut and the cached
+        // solutions, over the cached ones among colors
+        double max_difference(const color_lut& lut, std::span<const QRgb> colors) const;
+
+        // Writes the cache file if solve() changed anything since it was read
+        bool save();
+
+        size_t size() const;
+        bool empty() const;
+        size_t memory_usage() const;
+        const std::vector<latent_space_color>& palette() const;
+        const std::vector<QColor>& source_palette() const;
+    };
+
+}
@@ -0,0 +1,165 @@
+#include "sparse_lut.hpp"
+#include "lut_kernels.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <execution>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+namespace {
+
+    // Palette indices have to fit the 8-bit ink slots
+    constexpr int MAX_INKS = 256;
+
+    // Largest K accepted; a lookup blends at most 8 corners of K pairs
+    constexpr int MAX_K = 16;
+
+    struct weighted_ink {
+        uint8_t ink;
+        float weight;
+    };
+
+    // Sorts entries by decreasing weight, keeps the first k and rescales
+    // them to sum to 1. Returns the number kept.
+    int keep_top_k(weighted_ink* entries, int count, int k) {
+        int kept = std::min(count, k);
+        std::partial_sort(entries, entries + kept, entries + count,
+            [](const weighted_ink& a, const weighted_ink& b) { return a.weight > b.weight; });
+
+        float sum = 0.0f;
+        for (int j = 0; j < kept; ++j) {
+            sum += entries[j].weight;
+        }
+        if (sum > 0.0f) {
+            for (int j = 0; j < kept; ++j) {
+                entries[j].weight /= sum;
+            }
+        }
+        return kept;
+    }
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser::sparse_lut Implementation
+// -------------------------------------------------------------------------
+
+ser::sparse_lut::sparse_lut(const color_lut& dense, int k) :
+        palette_(dense.palette()),
+        interpolation_(dense.interpolation_mode()),
+        grid_size_(dense.grid_size()) {
+    const int n = static_cast<int>(palette_.size());
+    if (n == 0 || n > MAX_INKS) {
+        palette_.clear();
+        return;
+    }
+    k_ = std::clamp(k, 1, std::min(n, MAX_K));
+
+    // 1. A lazy LUT has to solve every node first
+    const int g = grid_size_;
+    dense.solve_all();
+
+    // 2. Keep the K largest coefficients of each node
+    const size_t nodes = static_cast<size_t>(g) * g * g;
+    inks_.assign(nodes * k_, 0);
+    weights_.assign(nodes * k_, 0.0f);
+    std::vector<int> slabs(g);
+    std::iota(slabs.begin(), slabs.end(), 0);
+    std::for_each(std::execution::par, slabs.begin(), slabs.end(), [&](int r) {
+        std::vector<weighted_ink> entries(n);
+        for (int gg = 0; gg < g; ++gg) {
+            for (int b = 0; b < g; ++b) {
+                auto coeffs = dense.node(r, gg, b);
+                for (int i = 0; i < n; ++i) {
+                    entries[i] = { static_cast<uint8_t>(i), coeffs[i] };
+                }
+                int kept = keep_top_k(entries.data(), n, k_);
+
+                size_t node = node_index(r, gg, b, g);
+                for (int j = 0; j < kept; ++j) {
+                    inks_[node * k_ + j] = entries[j].ink;
+                    weights_[node * k_ + j] = entries[j].weight;
+                }
+            }
+        }
+        });
+}
+
+void ser::sparse_lut::look_up(QRgb rgb, std::span<uint8_t> inks, std::span<float> weights) const {
+    if (k_ == 0) return;
+
+    // 1. Cell and fractional position, as color_lut computes them
+    const int g = grid_size_;
+    auto [base, tr, tg, tb] = locate(rgb, g);
+    const size_t r_step = static_cast<size_t>(g) * g;
+    const size_t g_step = static_cast<size_t>(g);
+
+    // 2. The corners to blend and their weights
+    size_t corner_nodes[8];
+    float corner_weights[8];
+    int corners = 0;
+    if (interpolation_ == interpolation::tetrahedral) {
+        tetrahedron t = select_tetrahedron(tr, tg, tb, r_step, g_step, 1);
+        corner_nodes[0] = base;
+        corner_nodes[1] = base + t.first;
+        corner_nodes[2] = base + t.second;
+        corner_nodes[3] = base + r_step + g_step + 1;
+        std::copy_n(t.w, 4, corner_weights);
+        corners = 4;
+    } else {
+        for (int c = 0; c < 8; ++c) {
+            int dr = (c >> 2) & 1;
+            int dg = (c >> 1) & 1;
+            int db = c & 1;
+            corner_nodes[c] = base + dr * r_step + dg * g_step + db;
+            corner_weights[c] = (dr ? tr : 1 - tr) * (dg ? tg : 1 - tg) * (db ? tb : 1 - tb);
+        }
+        corners = 8;
+    }
+
+    // 3. Sum the corners' pairs per ink, noting each ink the first time it
+    // gets weight; at most 8K distinct inks occur
+    float sums[MAX_INKS];
+    std::fill_n(sums, palette_.size(), 0.0f);
+    uint8_t seen[8 * MAX_K];
+    int count = 0;
+    for (int c = 0; c < corners; ++c) {
+        const uint8_t* node_inks = inks_.data() + corner_nodes[c] * k_;
+        const float* node_weights = weights_.data() + corner_nodes[c] * k_;
+        for (int j = 0; j < k_; ++j) {
+            float w = corner_weights[c] * node_weights[j];
+            if (w <= 0.0f) continue;
+            if (sums[node_inks[j]] == 0.0f) {
+                seen[count++] = node_inks[j];
+            }
+            sums[node_inks[j]] += w;
+        }
+    }
+
+    weighted_ink entries[8 * MAX_K];
+    for (int e = 0; e < count; ++e) {
+        entries[e] = { seen[e], sums[seen[e]] };
+    }
+
+    // 4. Keep the K largest again
+    int kept = keep_top_k(entries, count, k_);
+    for (int j = 0; j < k_; ++j) {
+        inks[j] = (j < kept) ? entries[j].ink : 0;
+        weights[j] = (j < kept) ? entries[j].weight : 0.0f;
+    }
+}
+
+int ser::sparse_lut::k() const {
+    return k_;
+}
+
+const std::vector<ser::latent_space_color>& ser::sparse_lut::palette() const {
+    return palette_;
+}
+
+size_t ser::sparse_lut::memory_usage() const {
+    return inks_.capacity() * sizeof(uint8_t) + weights_.capacity() * sizeof(float) +
+        palette_.capacity() * sizeof(latent_space_color);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "color_lut.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <QColor>
+
+namespace ser {
+
+    // Top-K form of a color_lut for large palettes. Each lattice node keeps
+    // only its K largest coefficients, renormalized to sum to 1, as (ink,
+    // weight) pairs. A lookup blends the pairs of the cell corners, keeps
+    // the K largest results and renormalizes again, so lookups, and the
+    // sparse separations built from them, carry K pairs per pixel instead
+    // of N coefficients. Ink indices are 8 bits, so palettes are limited to
+    // 256 inks.
+    class sparse_lut {
+
+        std::vector<uint8_t> inks_;   // K per node, by decreasing weight
+        aligned_vector<float> weights_;
+        std::vector<latent_space_color> palette_;
+        interpolation interpolation_ = interpolation::trilinear;
+        int grid_size_ = 0;
+        int k_ = 0;
+
+    public:
+
+        sparse_lut() {}
+        sparse_lut(const color_lut& dense, int k);
+
+        // Writes K (ink, weight) pairs for color, largest weight first. The
+        // weights sum to 1; unused slots, if fewer than K inks contribute,
+        // get weight 0.
+        void look_up(QRgb rgb, std::span<uint8_t> inks, std::span<float> weights) const;
+
+        int k() const;
+        const std::vector<latent_space_color>& palette() const;
+        size_t memory_usage() const;
+    };
+
+}
@@ -0,0 +1,461 @@
+#include "strip_io.hpp"
+#include <QFile>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if SERIGRAPH_HAS_PNG
+#include <png.h>
+#endif
+
+#if SERIGRAPH_HAS_TIFF
+#include <tiffio.h>
+#endif
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+
+namespace {
+
+    // Uncompressed size past which a TIFF is written as BigTIFF, whose
+    // offsets are not limited to 4 GB; compression may not get it under
+    constexpr size_t BIGTIFF_BYTES = size_t(1) << 31;
+
+    // zlib's state for a stream at its default settings: deflate's window
+    // and hash chains come to about 256 KB, inflate's window to 32 KB
+    constexpr size_t DEFLATE_BYTES = size_t(256) << 10;
+    constexpr size_t INFLATE_BYTES = size_t(48) << 10;
+
+    enum class file_format {
+        unknown,
+        png,
+        tiff
+    };
+
+    file_format sniff_format(const QString& path) {
+        FILE* file = std::fopen(QFile::encodeName(path).constData(), "rb");
+        if (!file) return file_format::unknown;
+        unsigned char magic[8] = {};
+        size_t read = std::fread(magic, 1, sizeof(magic), file);
+        std::fclose(file);
+
+        static constexpr unsigned char PNG_MAGIC[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        if (read == 8 && std::equal(magic, magic + 8, PNG_MAGIC)) return file_format::png;
+        // II or MM, then 42 for classic TIFF or 43 for BigTIFF
+        if (read >= 4 && ((magic[0] == 'I' && magic[1] == 'I' && (magic[2] == 42 || magic[2] == 43) && magic[3] == 0) ||
+            (magic[0] == 'M' && magic[1] == 'M' && magic[2] == 0 && (magic[3] == 42 || magic[3] == 43)))) {
+            return file_format::tiff;
+        }
+        return file_format::unknown;
+    }
+
+    file_format format_for_suffix(const QString& path) {
+        QString lower = path.toLower();
+        if (lower.endsWith(".png")) return file_format::png;
+        if (lower.endsWith(".tif") || lower.endsWith(".tiff")) return file_format::tiff;
+        return file_format::unknown;
+    }
+
+    size_t sample_bytes(ser::strip_content content) {
+        switch (content) {
+        case ser::strip_content::rgb:
+            return sizeof(QRgb);
+        case ser::strip_content::gray16:
+            return 2;
+        default:
+            return 1;
+        }
+    }
+
+    // The temporary file a writer fills, moved over the target by commit()
+    // and removed if the writer goes away without committing
+    class staged_file {
+
+        QString target_;
+        QString part_;
+        bool committed_ = false;
+
+    public:
+
+        explicit staged_file(const QString& target) : target_(target), part_(target + ".part") {}
+
+        ~staged_file() {
+            if (!committed_) QFile::remove(part_);
+        }
+
+        QByteArray local_path() const {
+            return QFile::encodeName(part_);
+        }
+
+        bool commit() {
+            QFile::remove(target_);
+            committed_ = QFile::rename(part_, target_);
+            return committed_;
+        }
+    };
+
+#if SERIGRAPH_HAS_PNG
+
+    // libpng reports errors by longjmp to the setjmp in the calling
+    // function, so the functions that call into it keep no locals with
+    // destructors
+
+    class png_reader final : public ser::strip_reader {
+
+        FILE* file_ = nullptr;
+        png_structp png_ = nullptr;
+        png_infop info_ = nullptr;
+        int wd_ = 0;
+        int hgt_ = 0;
+
+    public:
+
+        ~png_reader() override {
+            if (png_) png_destroy_read_struct(&png_, info_ ? &info_ : nullptr, nullptr);
+            if (file_) std::fclose(file_);
+        }
+
+        bool open(const char* path) {
+            file_ = std::fopen(path, "rb");
+            if (!file_) return false;
+            png_ = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+            if (!png_) return false;
+            info_ = png_create_info_struct(png_);
+            if (!info_) return false;
+            if (setjmp(png_jmpbuf(png_))) return false;
+
+            png_init_io(png_, file_);
+            png_read_info(png_, info_);
+            if (png_get_interlace_type(png_, info_) != PNG_INTERLACE_NONE) return false;
+
+            // Everything comes out as 8-bit B, G, R, A: a QRgb in memory
+            png_set_expand(png_);
+            png_set_strip_16(png_);
+            png_set_gray_to_rgb(png_);
+            png_set_filler(png_, 0xff, PNG_FILLER_AFTER);
+            png_set_bgr(png_);
+            png_read_update_info(png_, info_);
+
+            wd_ = static_cast<int>(png_get_image_width(png_, info_));
+            hgt_ = static_cast<int>(png_get_image_height(png_, info_));
+            return true;
+        }
+
+        int width() const override {
+            return wd_;
+        }
+
+        int height() const override {
+            return hgt_;
+        }
+
+        bool read_rows(QRgb* pixels, int count) override {
+            if (setjmp(png_jmpbuf(png_))) return false;
+            for (int y = 0; y < count; ++y) {
+                png_read_row(png_, reinterpret_cast<png_bytep>(pixels + static_cast<size_t>(y) * wd_), nullptr);
+            }
+            return true;
+        }
+
+        size_t memory_usage() const override {
+            // The current and previous row, at up to 16-bit RGBA before the
+            // transforms
+            return INFLATE_BYTES + 2 * (static_cast<size_t>(wd_) * 8 + 1);
+        }
+    };
+
+    class png_writer final : public ser::strip_writer {
+
+        staged_file staged_;
+        FILE* file_ = nullptr;
+        png_structp png_ = nullptr;
+        png_infop info_ = nullptr;
+        int wd_ = 0;
+        size_t row_bytes_ = 0;
+
+    public:
+
+        explicit png_writer(const QString& path) : staged_(path) {}
+
+        ~png_writer() override {
+            if (png_) png_destroy_write_struct(&png_, info_ ? &info_ : nullptr);
+            if (file_) std::fclose(file_);
+        }
+
+        bool open(int width, int height, ser::strip_content content) {
+            wd_ = width;
+            row_bytes_ = static_cast<size_t>(width) * sample_bytes(content);
+            file_ = std::fopen(staged_.local_path().constData(), "wb");
+            if (!file_) return false;
+            png_ = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+            if (!png_) return false;
+            info_ = png_create_info_struct(png_);
+            if (!info_) return false;
+            if (setjmp(png_jmpbuf(png_))) return false;
+
+            png_init_io(png_, file_);
+            int bit_depth = (content == ser::strip_content::gray16) ? 16 : 8;
+            int color_type = (content == ser::strip_content::rgb) ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_GRAY;
+            png_set_IHDR(png_, info_, width, height, bit_depth, color_type, PNG_INTERLACE_NONE,
+                PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+            // The encoder thread paces the pipeline; above level 3 zlib gets
+            // much slower for files hardly any smaller
+            png_set_compression_level(png_, 3);
+            png_write_info(png_, info_);
+
+            // Rows arrive as QRgb, whose fourth byte is dropped, or as
+            // native-endian 16-bit samples, which PNG stores big-endian
+            if (content == ser::strip_content::rgb) {
+                png_set_filler(png_, 0, PNG_FILLER_AFTER);
+                png_set_bgr(png_);
+            }
+            else if (content == ser::strip_content::gray16) {
+                png_set_swap(png_);
+            }
+            return true;
+        }
+
+        bool write_rows(const void* rows, int count) override {
+            if (setjmp(png_jmpbuf(png_))) return false;
+            const png_byte* row = static_cast<const png_byte*>(rows);
+            for (int y = 0; y < count; ++y) {
+                png_write_row(png_, row + static_cast<size_t>(y) * row_bytes_);
+            }
+            return true;
+        }
+
+        bool finish() override {
+            if (setjmp(png_jmpbuf(png_))) return false;
+            png_write_end(png_, nullptr);
+            png_destroy_write_struct(&png_, &info_);
+            bool closed = (std::fclose(file_) == 0);
+            file_ = nullptr;
+            return closed;
+        }
+
+        bool commit() override {
+            return staged_.commit();
+        }
+
+        size_t memory_usage() const override {
+            // The current and previous row and one per filter tried
+            return DEFLATE_BYTES + 7 * (row_bytes_ + 1);
+        }
+    };
+
+#endif
+
+#if SERIGRAPH_HAS_TIFF
+
+    class tiff_reader final : public ser::strip_reader {
+
+        TIFF* tif_ = nullptr;
+        uint32_t wd_ = 0;
+        uint32_t hgt_ = 0;
+        uint16_t samples_ = 0;
+        uint16_t bits_ = 0;
+        uint32_t row_ = 0;
+        std::vector<uint8_t> line_;
+
+    public:
+
+        ~tiff_reader() override {
+            if (tif_) TIFFClose(tif_);
+        }
+
+        bool open(const char* path) {
+            tif_ = TIFFOpen(path, "rm");
+            if (!tif_ || TIFFIsTiled(tif_)) return false;
+
+            uint16_t photometric = 0;
+            uint16_t planar = PLANARCONFIG_CONTIG;
+            TIFFGetField(tif_, TIFFTAG_IMAGEWIDTH, &wd_);
+            TIFFGetField(tif_, TIFFTAG_IMAGELENGTH, &hgt_);
+            TIFFGetFieldDefaulted(tif_, TIFFTAG_SAMPLESPERPIXEL, &samples_);
+            TIFFGetFieldDefaulted(tif_, TIFFTAG_BITSPERSAMPLE, &bits_);
+            TIFFGetFieldDefaulted(tif_, TIFFTAG_PLANARCONFIG, &planar);
+            if (!TIFFGetField(tif_, TIFFTAG_PHOTOMETRIC, &photometric)) return false;
+
+            bool gray = (photometric == PHOTOMETRIC_MINISBLACK && (samples_ == 1 || samples_ == 2));
+            bool rgb = (photometric == PHOTOMETRIC_RGB && (samples_ == 3 || samples_ == 4));
+            if (!(gray || rgb) || (bits_ != 8 && bits_ != 16) || planar != PLANARCONFIG_CONTIG) return false;
+            if (wd_ == 0 || hgt_ == 0 || wd_ > INT32_MAX || hgt_ > INT32_MAX) return false;
+
+            line_.resize(TIFFScanlineSize(tif_));
+            return true;
+        }
+
+        int width() const override {
+            return static_cast<int>(wd_);
+        }
+
+        int height() const override {
+            return static_cast<int>(hgt_);
+        }
+
+        bool read_rows(QRgb* pixels, int count) override {
+            // 16-bit samples arrive in native byte order; their high byte
+            // is the 8-bit value
+            const bool wide = (bits_ == 16);
+            const bool gray = (samples_ < 3);
+            for (int y = 0; y < count; ++y) {
+                if (row_ >= hgt_ || TIFFReadScanline(tif_, line_.data(), row_++, 0) < 0) return false;
+
+                const uint16_t* line16 = reinterpret_cast<const uint16_t*>(line_.data());
+                auto sample = [&](size_t i) {
+                    return wide ? static_cast<int>(line16[i] >> 8) : static_cast<int>(line_[i]);
+                    };
+                QRgb* out = pixels + static_cast<size_t>(y) * wd_;
+                for (uint32_t x = 0; x < wd_; ++x) {
+                    size_t i = static_cast<size_t>(x) * samples_;
+                    out[x] = gray ? qRgb(sample(i), sample(i), sample(i))
+                        : qRgb(sample(i), sample(i + 1), sample(i + 2));
+                }
+            }
+            return true;
+        }
+
+        size_t memory_usage() const override {
+            // libtiff reads a whole strip, still compressed, and decodes it
+            // into a buffer of its own
+            tmsize_t strip = TIFFStripSize(tif_);
+            return line_.size() + 2 * static_cast<size_t>(std::max<tmsize_t>(strip, 0)) + INFLATE_BYTES;
+        }
+    };
+
+    class tiff_writer final : public ser::strip_writer {
+
+        staged_file staged_;
+        TIFF* tif_ = nullptr;
+        int wd_ = 0;
+        uint32_t row_ = 0;
+        ser::strip_content content_ = ser::strip_content::rgb;
+        std::vector<uint8_t> line_;
+
+    public:
+
+        explicit tiff_writer(const QString& path) : staged_(path) {}
+
+        ~tiff_writer() override {
+            if (tif_) TIFFClose(tif_);
+        }
+
+        bool open(int width, int height, ser::strip_content content) {
+            wd_ = width;
+            content_ = content;
+            const bool rgb = (content == ser::strip_content::rgb);
+            const uint16_t samples = rgb ? 3 : 1;
+            const uint16_t bits = (content == ser::strip_content::gray16) ? 16 : 8;
+            const size_t bytes = static_cast<size_t>(width) * height * samples * (bits / 8);
+
+            tif_ = TIFFOpen(staged_.local_path().constData(), bytes > BIGTIFF_BYTES ? "w8" : "w");
+            if (!tif_) return false;
+            TIFFSetField(tif_, TIFFTAG_IMAGEWIDTH, static_cast<uint32_t>(width));
+            TIFFSetField(tif_, TIFFTAG_IMAGELENGTH, static_cast<uint32_t>(height));
+            TIFFSetField(tif_, TIFFTAG_SAMPLESPERPIXEL, samples);
+            TIFFSetField(tif_, TIFFTAG_BITSPERSAMPLE, bits);
+            TIFFSetField(tif_, TIFFTAG_PHOTOMETRIC, rgb ? PHOTOMETRIC_RGB : PHOTOMETRIC_MINISBLACK);
+            TIFFSetField(tif_, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+            TIFFSetField(tif_, TIFFTAG_COMPRESSION, COMPRESSION_LZW);
+            TIFFSetField(tif_, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(tif_, 0));
+
+            line_.resize(static_cast<size_t>(width) * samples * (bits / 8));
+            return true;
+        }
+
+        bool write_rows(const void* rows, int count) override {
+            // libtiff may encode in place, so each row goes through line_
+            const size_t row_bytes = static_cast<size_t>(wd_) * sample_bytes(content_);
+            for (int y = 0; y < count; ++y) {
+                const uint8_t* row = static_cast<const uint8_t*>(rows) + y * row_bytes;
+                if (content_ == ser::strip_content::rgb) {
+                    const QRgb* pixels = reinterpret_cast<const QRgb*>(row);
+                    for (int x = 0; x < wd_; ++x) {
+                        line_[3 * x] = static_cast<uint8_t>(qRed(pixels[x]));
+                        line_[3 * x + 1] = static_cast<uint8_t>(qGreen(pixels[x]));
+                        line_[3 * x + 2] = static_cast<uint8_t>(qBlue(pixels[x]));
+                    }
+                }
+                else {
+                    std::memcpy(line_.data(), row, row_bytes);
+                }
+                if (TIFFWriteScanline(tif_, line_.data(), row_++, 0) < 0) return false;
+            }
+            return true;
+        }
+
+        bool finish() override {
+            bool flushed = (TIFFFlush(tif_) == 1);
+            TIFFClose(tif_);
+            tif_ = nullptr;
+            return flushed;
+        }
+
+        bool commit() override {
+            return staged_.commit();
+        }
+
+        size_t memory_usage() const override {
+            // A strip before and after LZW, whose tables are small
+            tmsize_t strip = tif_ ? TIFFStripSize(tif_) : 0;
+            return line_.size() + 2 * static_cast<size_t>(std::max<tmsize_t>(strip, 0)) + (size_t(64) << 10);
+        }
+    };
+
+#endif
+
+} // namespace
+
+// -------------------------------------------------------------------------
+// ser:: Free Functions
+// -------------------------------------------------------------------------
+
+std::unique_ptr<ser::strip_reader> ser::open_strip_reader(const QString& path) {
+    switch (sniff_format(path)) {
+#if SERIGRAPH_HAS_PNG
+    case file_format::png: {
+        auto reader = std::make_unique<png_reader>();
+        if (reader->open(QFile::encodeName(path).constData())) return reader;
+        break;
+    }
+#endif
+#if SERIGRAPH_HAS_TIFF
+    case file_format::tiff: {
+        auto reader = std::make_unique<tiff_reader>();
+        if (reader->open(QFile::encodeName(path).constData())) return reader;
+        break;
+    }
+#endif
+    default:
+        break;
+    }
+    return nullptr;
+}
+
+std::unique_ptr<ser::strip_writer> ser::create_strip_writer(const QString& path, int width, int height,
+        strip_content content) {
+    if (width <= 0 || height <= 0) return nullptr;
+
+    switch (format_for_suffix(path)) {
+#if SERIGRAPH_HAS_PNG
+    case file_format::png: {
+        auto writer = std::make_unique<png_writer>(path);
+        if (writer->open(width, height, content)) return writer;
+        break;
+    }
+#endif
+#if SERIGRAPH_HAS_TIFF
+    case file_format::tiff: {
+        auto writer = std::make_unique<tiff_writer>(path);
+        if (writer->open(width, height, content)) return writer;
+        break;
+    }
+#endif
+    default:
+        break;
+    }
+    return nullptr;
+}
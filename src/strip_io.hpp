@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QColor>
+#include <QString>
+#include <cstddef>
+#include <memory>
+
+namespace ser {
+
+    // Row-by-row access to image files too large to decode at once, for the
+    // out-of-core pipeline (strip_pipeline.hpp). PNG goes through libpng and
+    // TIFF through libtiff, each only if the build found the library.
+    //
+    // Readers decode rows in order as packed RGB32. 8- and 16-bit PNG of
+    // any color type is read, except interlaced files, which cannot be
+    // streamed; TIFF must be strip-organized, contiguous, 8- or 16-bit
+    // grayscale or RGB, with or without alpha.
+    class strip_reader {
+    public:
+        virtual ~strip_reader() {}
+
+        virtual int width() const = 0;
+        virtual int height() const = 0;
+
+        // Decodes the next count rows into pixels, width() per row. False
+        // on a read error, after which the reader is unusable.
+        virtual bool read_rows(QRgb* pixels, int count) = 0;
+
+        // Estimated bytes the decoder holds: its buffers and codec state
+        virtual size_t memory_usage() const = 0;
+    };
+
+    // What a strip_writer stores per pixel: RGB from packed RGB32, or one
+    // 8- or 16-bit grayscale sample, as in an ink plane
+    enum class strip_content {
+        rgb,
+        gray8,
+        gray16
+    };
+
+    // Writers encode rows in order into a temporary file beside the target.
+    // finish() completes and closes that file, and commit() then moves it
+    // into place, so a failed or abandoned run never leaves a truncated file
+    // under the target name; a writer destroyed before commit() removes it.
+    // Keeping the two apart lets a set of outputs all be finished before
+    // any of them replaces its target. The format follows the suffix: .png,
+    // or .tif/.tiff (BigTIFF past 2 GB of samples).
+    class strip_writer {
+    public:
+        virtual ~strip_writer() {}
+
+        // count rows of width samples each, QRgb for rgb content, uint8_t or
+        // uint16_t for gray8 and gray16
+        virtual bool write_rows(const void* rows, int count) = 0;
+        virtual bool finish() = 0;
+        virtual bool commit() = 0;
+
+        // Estimated bytes the encoder holds: its buffers and codec state
+        virtual size_t memory_usage() const = 0;
+    };
+
+    // nullptr if the file cannot be opened or its format is unsupported
+    std::unique_ptr<strip_reader> open_strip_reader(const QString& path);
+    std::unique_ptr<strip_writer> create_strip_writer(const QString& path, int width, int height,
+        strip_content content);
+
+}
@@ -0,0 +1,230 @@
+#include "strip_pipeline.hpp"
+#include "serigraph.hpp"
+#include "strip_io.hpp"
+#include <QImage>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <execution>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+// -------------------------------------------------------------------------
+// Internal Helpers & Constants (Anonymous Namespace)
+// -------------------------------------------------------------------------
+
+namespace {
+
+    // One strip per pipeline stage
+    constexpr int STRIPS_IN_FLIGHT = 3;
+
+    // Strips are cut on the separation's tile rows where the budget allows
+    constexpr int STRIP_ALIGNMENT = ser::ink_separation::TILE_HEIGHT;
+
+    // A strip's buffers, allocated for the first strip and reused for the
+    // rest. Reusing them rather than freeing each strip's results matters:
+    // glibc serves freed blocks of this size from the heap afterwards, and
+    // the heap fragments until it holds several times the budget. The tile
+    // marks of reused layers go stale, but only the planes are written.
+    struct strip {
+        int rows = 0;
+        std::vector<QRgb> pixels;
+        QImage reinked;
+        ser::ink_separation layers;
+    };
+
+    // Hands strip numbers from one stage to the next. Once closed, pop
+    // drains what is left and then returns false.
+    class strip_queue {
+
+        std::mutex mutex_;
+        std::condition_variable ready_;
+        std::deque<int> items_;
+        bool closed_ = false;
+
+    public:
+
+        void push(int item) {
+            {
+                std::lock_guard lock(mutex_);
+                items_.push_back(item);
+            }
+            ready_.notify_one();
+        }
+
+        bool pop(int& item) {
+            std::unique_lock lock(mutex_);
+            ready_.wait(lock, [&] { return closed_ || !items_.empty(); });
+            if (items_.empty()) return false;
+            item = items_.front();
+            items_.pop_front();
+            return true;
+        }
+
+        void close() {
+            {
+                std::lock_guard lock(mutex_);
+                closed_ = true;
+            }
+            ready_.notify_all();
+        }
+    };
+
+    int strip_height(size_t budget, size_t row_bytes, int height) {
+        size_t rows = budget / (STRIPS_IN_FLIGHT * row_bytes);
+        if (rows >= static_cast<size_t>(STRIP_ALIGNMENT)) rows -= rows % STRIP_ALIGNMENT;
+        return static_cast<int>(std::clamp<size_t>(rows, 1, height));
+    }
+}
+
+// -------------------------------------------------------------------------
+// ser:: Free Functions
+// -------------------------------------------------------------------------
+
+int ser::separate_file(const QString& path, const color_lut& lut,
+        const std::vector<latent_space_color>& target_palette, const strip_settings& settings,
+        const job_control& job) {
+    const size_t num_inks = lut.palette().size();
+    const bool want_image = !settings.reinked_path.isEmpty();
+    const bool want_layers = !settings.layer_pattern.isEmpty();
+    if (num_inks == 0 || !(want_image || want_layers)) return -1;
+    if (want_image && target_palette.size() != num_inks) return -1;
+
+    // 1. Open the input and every output up front, so that nothing is
+    // computed for files that cannot be written
+    auto reader = open_strip_reader(path);
+    if (!reader) return -1;
+    const int width = reader->width();
+    const int height = reader->height();
+
+    // The re-inked image comes first, then one plane per ink
+    const ink_format format = (settings.layer_format == ink_format::uint8) ? ink_format::uint8 : ink_format::uint16;
+    std::vector<std::unique_ptr<strip_writer>> writers;
+    if (want_image) {
+        writers.push_back(create_strip_writer(settings.reinked_path, width, height, strip_content::rgb));
+        if (!writers.back()) return -1;
+    }
+    for (size_t i = 0; want_layers && i < num_inks; ++i) {
+        auto content = (format == ink_format::uint8) ? strip_content::gray8 : strip_content::gray16;
+        writers.push_back(create_strip_writer(settings.layer_pattern.arg(i + 1), width, height, content));
+        if (!writers.back()) return -1;
+    }
+
+    // 2. Size the strips so that all of them together fit what the budget
+    // leaves after the LUT and the codecs
+    size_t overhead = lut.memory_usage() + reader->memory_usage();
+    for (const auto& writer : writers) overhead += writer->memory_usage();
+    const size_t strip_budget = (settings.memory_budget > overhead) ? settings.memory_budget - overhead : 0;
+
+    size_t row_bytes = width * sizeof(QRgb);
+    if (want_image) row_bytes += width * sizeof(QRgb);
+    if (want_layers) row_bytes += num_inks * width * element_size(format);
+    const int rows_per_strip = strip_height(strip_budget, row_bytes, height);
+
+    std::vector<strip> strips(STRIPS_IN_FLIGHT);
+    strip_queue free_strips;
+    strip_queue decoded;
+    strip_queue computed;
+    for (int s = 0; s < STRIPS_IN_FLIGHT; ++s) {
+        strips[s].pixels.resize(static_cast<size_t>(rows_per_strip) * width);
+        free_strips.push(s);
+    }
+
+    // Any stage that fails closes every queue, which winds down the others
+    std::atomic<bool> failed = false;
+    auto fail = [&]() {
+        failed = true;
+        free_strips.close();
+        decoded.close();
+        computed.close();
+        };
+
+    // 3. Decode stage
+    std::jthread decoder([&]() {
+        int s;
+        for (int y = 0; y < height && free_strips.pop(s); y += rows_per_strip) {
+            if (failed || job.stop_requested()) break;
+            strips[s].rows = std::min(rows_per_strip, height - y);
+            if (!reader->read_rows(strips[s].pixels.data(), strips[s].rows)) {
+                fail();
+                break;
+            }
+            decoded.push(s);
+        }
+        decoded.close();
+        });
+
+    // 4. Encode stage. The files are compressed independently, so they are
+    // written in parallel.
+    std::vector<size_t> files(writers.size());
+    std::iota(files.begin(), files.end(), size_t(0));
+    std::atomic<int> rows_written = 0;
+    std::jthread encoder([&]() {
+        int s;
+        while (computed.pop(s)) {
+            if (failed) break;
+            const strip& st = strips[s];
+            std::atomic<bool> ok = true;
+            std::for_each(std::execution::par, files.begin(), files.end(), [&](size_t f) {
+                size_t ink = want_image ? f - 1 : f;
+                const void* rows = (want_image && f == 0) ? st.reinked.constBits() : st.layers[ink].row_data(0);
+                if (!writers[f]->write_rows(rows, st.rows)) ok = false;
+                });
+            if (!ok) {
+                fail();
+                break;
+            }
+            rows_written += st.rows;
+            job.report(static_cast<double>(rows_written) / height);
+            free_strips.push(s);
+        }
+        });
+
+    // 5. Compute stage, on this thread and the parallel algorithms' workers
+    job_control step{ job.stop };
+    int rows_computed = 0;
+    int s;
+    while (decoded.pop(s)) {
+        if (failed || job.stop_requested()) break;
+        strip& st = strips[s];
+        QImage input(reinterpret_cast<const uchar*>(st.pixels.data()), width, st.rows,
+            width * sizeof(QRgb), QImage::Format_RGB32);
+        if (want_image) {
+            // The old planes go first, or the last, shorter strip would
+            // briefly hold two strips' worth
+            if (want_layers && st.layers.height() != st.rows) {
+                st.layers = ink_separation();
+                st.layers = ink_separation(num_inks, width, st.rows, format);
+            }
+            st.reinked = QImage();
+            st.reinked = separate_and_reink(input, lut, target_palette, step, want_layers ? &st.layers : nullptr);
+            if (st.reinked.isNull()) break;
+        }
+        else {
+            st.layers = ink_separation();
+            st.layers = separate_image(input, lut, step, format);
+            if (st.layers.empty()) break;
+        }
+        rows_computed += st.rows;
+        computed.push(s);
+    }
+    if (rows_computed != height) fail();
+    computed.close();
+    decoder.join();
+    encoder.join();
+
+    // 6. Only a complete run replaces the outputs, and only once every one
+    // of them is finished, so that a file failing to close leaves all the
+    // targets as they were
+    if (failed || job.stop_requested() || rows_written != height) return -1;
+    for (auto& writer : writers) {
+        if (!writer->finish()) return -1;
+    }
+    for (auto& writer : writers) {
+        if (!writer->commit()) return -1;
+    }
+    return height;
+}
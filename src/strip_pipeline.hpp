@@ -0,0 +1,46 @@
+#pragma once
+
+#include "color_lut.hpp"
+#include "ink_layer.hpp"
+#include "job_control.hpp"
+#include <QString>
+#include <cstddef>
+#include <vector>
+
+namespace ser {
+
+    // Outputs and limits of separate_file
+    struct strip_settings {
+        // The re-inked image; empty for none
+        QString reinked_path;
+
+        // One grayscale file per ink, %1 standing for the ink number from 1;
+        // empty for none
+        QString layer_pattern;
+
+        // uint16 or uint8 ink planes; float32 is written as uint16
+        ink_format layer_format = ink_format::uint16;
+
+        // Bytes for the run: the LUT, the codecs' buffers and, in what they
+        // leave, the strips in flight, which hold decoded input, re-inked
+        // output and coverage. Thread stacks and the per-tile scratch of
+        // the separation, under a megabyte, come on top.
+        size_t memory_budget = size_t(512) << 20;
+    };
+
+    // Out-of-core separation of an image file of any size. The image is
+    // streamed through in horizontal strips by a three-stage pipeline: one
+    // thread decodes strip s + 1 while separate_and_reink works on strip s
+    // and another thread encodes strip s - 1 into the output files. Strips
+    // are as tall as memory_budget, less the LUT and the codecs, allows for
+    // three of them at once, so memory use depends on the budget and the
+    // image width, not its height.
+    //
+    // Reads and writes what strip_io.hpp supports. Returns the number of
+    // rows written, or -1 if a file cannot be read or written, the palettes
+    // do not match or the job is cancelled; the outputs are then left alone.
+    int separate_file(const QString& path, const color_lut& lut,
+        const std::vector<latent_space_color>& target_palette, const strip_settings& settings,
+        const job_control& job = {});
+
+}
@@ -239,6 +239,11 @@ void mixbox_latent_to_linear_float_rgb(mixbox_latent latent, float* out_r, float
   latent_to_linear_float_rgb(latent, out_r, out_g, out_b);
 }
 
+const unsigned char* mixbox_lut_data(void)
+{
+  return mixbox_lut();
+}
+
 void mixbox_lerp(unsigned char r1, unsigned char g1, unsigned char b1,
                  unsigned char r2, unsigned char g2, unsigned char b2,
                  float t,
@@ -302,6 +307,8 @@ void mixbox_lerp_linear_float(float r1, float g1, float b1,
   latent_to_linear_float_rgb(latent_mix, out_r, out_g, out_b);
 }
 
+#ifndef MIXBOX_PRECOMPUTED_LUT
+
 static const char* mixbox_lut_compressed[] =
 {
   "Y_4H8E8b(No7xgiXspim?\?;c^Nh9gZ[Y4hIA`P^oa-KlSP(q12Zbc'[;L.x:Jp:Fi=g(;TR1h_L@wXPmAxcw>sUJVclFj*,h=<(N-5V+NOSdCfQ]+,])_Fok#uwI17WW84^Uq*7Gu-UKu#UNI>?.Rt]JqR1_8jk/5`#8-R`1Ik*h#=Wms`LBPxhkt1<P38x8@q8uDsj/4*aw5u'aQ(.A5CXI<d<Q8sPHR,M;aGi174#BEZf[f4b<23CqI$A:.)IoS+8mnd6ljs>u3UUbcc0(]eCp:kKfn?15gDJcG8'u>9upwptk*ih=*DrOb%S3lC1Yr)RoC#ul*4EawhL;tm4)DFqMO?sF5@WHtRhZ#(3iSU$O-B,)8dp_q[VEftFDC5h@rI&69u1>39s-GYO7dq^R')XKr_fortbZ...Bxd8GO<EB4C._RwMCR2Za@GTJcGPuUnt$t487xia$5wY[qw=n&hQ#Y9b#Y8lbtXB'L)v[MSbw.cD,1Y1A,,Sa.3pw9*V@iT;J+D+r(C$EYBPqtMc).,rvQ#bTH_04fFik_<>5nKuAe^?t[<w&Wjv6`VHOm'5#W:^?,U&WHPv4EI(0g@rHUlo<xL2IFuGh2vNe7lp*Ci>@CtHwU^IV*DfYha]5,wwO'u4]NCC5jF'jcfu&X)Fjv=FMQ(ZQ(E$-bP3e&1+NHBIop@LME$Wq;Cd^l1jsflu;dt&g]1(kJ^.DFETdL)Qrukvj+H=gvmKI%]-vb]ZxpX>KcK52`5$n+eC%[8?2D8X0KMo#?:3v5udr@J$.LtxrPe$lxf2NmYMk'w#.^g@i#psWp95N?R#<[dUnj4-]Ps&+B:M<8f?.&jcLuC$5E$QtDwtrk1.T2u)u?qsw]<Kot)QqHx/f:N*);1uNj/V;cDC-Iqn;?,H>m$9_BO4bQd0olP<8=Xg[a:@_:];T$@-1T&u?,fp^TtVE3@nW,;e-`dL+Tbgmt2DN%?V:d%HSre9I$^rvn+CWDQs5$?+JmnHab:<-_SRi=h)8NE;ZTG]mQDZlT(<Yu=-b]5Vw#dKPrhvkVv:A@Oh^PQ@gXVgUS8X<EK1D%t1j4We_,9@takJ0;N%EWJd5-D757K#tdxAG*A::#Ihe`w^c.dd=Rj@=XSIgmeWb%:uipN_I/1F'b.+oQfAG%HEc:aDQu]x'*t@Pg@rwvWioSVsjS>[eVb#7VGmD`upd'5+]X>EHqtp)SXC#b=jad8hgnbm`@LjE+@.Vm]lXbhZMRFKVSp+[l-fl7'b*5nBg]Qu+HiBn%hqq_'qc[&D1;:q.]4v>ieT[#Tui=?pCLKtFAs1]#T5%?g^_b`/=u66@.M^]$4t+$Qidn%(h*4Bvml7((q-O:ZV&;MEQS@*8Q79_=t#;D4-]&=0?T;iv&qj[U69tq)@0qw1LgUjQY]+]=ul?F'KC4416<PbK,7HI@iq^P;EajLJ4Gi>(M8:)?BgE$c[*8`1bI0&^a/2hM5XI&Fne1pBsohq]*o+ek(fLaMf6>CsC),2TI3=LP//J_ncuDt/3#hvUL;17+(pgjrKk6g_A1BXht/H=Q,`*`'8sv$+AoWMAD+)k*KdvgJ<jYn(Eemx(^upQ)@O5Iw@Q5Ul8B#2uC/WvQ^F;a$*1`)s>&]0m?Ag?oencpd1NqP#P,Te_f[mt9*t);TmvZ,Wa*[mP;$#VOj/BDf&DCOt2bUJ]`n<W*4m#s1]_qTin*t]k[gUZh&S$-jFD=;n4`P^DNZWrPqER*C.8;)j*NjNMN&Y3mm4B,i]>-Up&SRt>R/m(N-b2pFDTs@xKl<.eff)%vOhAndrM(h@lPj<*g*>d?4qvn1u@f]?r%tOQ2Gwg;6S;ZS@)c=M.GMjgq=1bpQWtn@WAeX2aAf6eaZ5f>6sSV'(k7EL@q][+%/qO,(O9-:kDW<.g3+RtoMiOmX5xA'FB2.,>Qxr@DX$EwX1ZZgK1kwxg`u$(MW7[G/90xGn1o]Kk<=uT?GjDw1[^`'=f%an`vZ)Cpv,I3=QH:rFtL)<N@%jds*8W3C_*J3,k<dp7T8[)p*uSV<TL3@7>rL[C`5c9S&tR%<Csm*=KtpPEgEO*WB`X_n0-P9Vdg'?JL4k3j_c%nhv_9X&RF]6#DSB6D+u8c:`;DkYR71[NY0g)tJpgD?D`wqQNtu'qX$<P@uWD_FcF.c%+72hH`wwL0(CPC75^'7V1cS7BN^ADeIs*Idn_xYKiV8h*MK=,GR<CM;g0Ak'`FtDufqtjQD+GwDP#W,>PTxXB]OIa]%57O1=v5*gN]BB^5+s?QNf2$ujT2&Dci.QH/)5%5i@B2B4r<eD8&.1Mf##k$cqNE:`AdEr?.nn<6a8X4Cv&^Nb['L,]&d`@=wH,]Six_&&vPL0xSn_X?7Q^IW*oPDvpj-Jc9Lvox9]BL]*:qkPtN@XNc9sN?e*<V$DqA_uL9:RH<0d;Pf=u`g8KS-epugdO_;%^MSFN``N6qT#gY7e9:g&[.<apl-`EF+Z0;JI>&<tP4W;VL/+d21Ol>_-vi@YZIs@(C*T2kVR5<s'ZKi2ac_Y=P-,I`#RjXh&+xe&@It)pE$]bD3ZP#+eTV`gSMX[K`ru`R%YW6XI[Mi=P12e(NJoBbnQ/0^7O*[Rb/Ywn;4c]TgN8vA2pSoDIDq7xr6<>N8j3:<6J+%;AjLcQ-d`a/v;PQE7S$5ejS:;ku?l]SWH*dfqxS2TA9o_-CbYBX%>Z+18eRj'u]j(I@@XhNc5.rsH@=8w4x>]=hx@[5fRbYT+e?^d62%c-(7`7i$Cpt5v<dqsB30Cq#+P15>lQ:dDI8t6D$(ceC#.D.WEZ9l%F[)rXGNX+eA`U>?EmY:?tqO[c[%V[4g#aVoVZ,[d/`#?c`[2,7B'Wm_sv?rB<>GN4[UHi/_beqOq`'C?5aM+g;9V#OJ89#.)+sIZ+J),lXID8KflDb1wiUx1FrN-p15FI:j&H7Psf_40e]g)nbcMJlI)0&lrRhu]Gf?YO/aKnO<=;]('Q$Ko29@h;36BP/ES2ru<W/TauEWJ4B_5c=FJHd1.mxSe'R(0/xW[A5@-([<eIZIUGR<eE7Jwg[jV;bPXh-j<G^+rD-TK9UEN*VTDAL[4Mj[L01],gN'p6&4]0^hpDCOhBJl[V<<ZQif2]F4fMU^D'kIE%#Y^qgiAZQL0A$%</76_GS8cKY(1O>)U.,uIW+<#U2brj7[o=?@iL*7H0INhUs-tUikAlZjbYi<HhRHV)[.tBMU[Bf9kou^lVxhK<l[>w$tFKi&jm>]Y&#Su,2QMZDm:7^J6::sOtr]?#prdf>Lg$Xt-(UrR=N&`AW6g$h&a^gX.KA<R[x8THQY8SN*S,;wmr=%_,;tVr609d^aVF,n]W_0YZ,_nB:K$=q@R'R=->W?ad5f;vA8Gvq5cqFd:nZ`Y$P959HmK1$[9_CvuN8K[<jIN]UJ5$Zd9[c]kCjaI3WoUf?01e+C@27E[m+1pt<K&&rKXSxmReE9Z,&b7rYNI?UE<t`?WKWn;Anf@>Vi@eDnJS17NG[LX`9r7gPs98dHI^>o:m>WeBT6juvWGYuh7c:Q%+lQuqT=)c&],?Y.;1U&S7s;@x;ZnIPC>,L2f78SOb3]<p*rmBke^IukEc@Ee]Bwb`GV$&PFqOt^c4o/NRw#rlE8#U^oGfm?.#vUP=#-17D6GEnr]JaDi0[<m2ml-MUlgpiM-L?_31$u0MTG0o8H0b+/viKK$-k]VaXBpe>gC,@-5J(65^@;iGi-5C>-m7B:NaA*T2]+I'#7u?q;os2+/*hw$k&;:/H-o<0dFGXJ8E2%jn$L:GLhu-<]_r%8N_YSpb(uXD2uuY$LRh5$MYuf&1Er7Y_x[mj1F75JY#u'_D.Lc#icu51co<CwjQNKb1;,ds9QZ^5b&[G7[%I]ZX0?d>iYYPwbi'RA#66,6ZEroL^`1cxB$uY0F.iUUijB?K`H5[3i-Ao#b,4TQN2v7?W$4P^nr$w#+dsVZM@tbT&Y<6%Y*#HgFX7R*,(vcQs1S)a9:*m;O1E.l>;:q&%HADB:US58e4vBogv:E=Wts^_wQkH'(J1u_M#1KK5F)[W^F2@x,isQl6`swn61<PN5,t'=l+*WKEQn)A#;u",
@@ -695,7 +702,7 @@ INLINE static const unsigned char* mixbox_lut()
 {
   struct mixbox_init_t
   {
-    unsigned char lut[64*64*64*3 + 12675];
+    unsigned char lut[MIXBOX_LUT_SIZE];
     mixbox_init_t() { decompress((char*)lut, sizeof(lut)); }
   };
 
@@ -703,3 +710,15 @@ INLINE static const unsigned char* mixbox_lut()
 
   return decompressed.lut;
 }
+
+#else
+
+// Decompressed at build time by generate_mixbox_lut into read-only data
+extern "C" const unsigned char mixbox_precomputed_lut[MIXBOX_LUT_SIZE];
+
+INLINE static const unsigned char* mixbox_lut()
+{
+  return mixbox_precomputed_lut;
+}
+
+#endif
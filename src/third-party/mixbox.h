@@ -82,6 +82,14 @@ void mixbox_latent_to_float_rgb(mixbox_latent latent, float* out_r, float* out_g
 void mixbox_linear_float_rgb_to_latent(float r, float g, float b, mixbox_latent out_latent);
 void mixbox_latent_to_linear_float_rgb(mixbox_latent latent, float* out_r, float* out_g, float* out_b);
 
+// The decompressed 64x64x64 RGB -> pigment table, 3 bytes per entry plus
+// padding, for batched conversions outside this file. It is inflated on
+// first use unless the build defines MIXBOX_PRECOMPUTED_LUT and links in
+// the table generated by generate_mixbox_lut.
+#define MIXBOX_LUT_SIZE (64*64*64*3 + 12675)
+
+const unsigned char* mixbox_lut_data(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,114 @@
+// Benchmark: trilinear against tetrahedral LUT interpolation. Reports the
+// error of both against exact solves at random colors, and look_up_row
+// throughput on a smooth gradient and on random pixels.
+//
+// usage: bench_interpolation [inks] [samples] [width] [height]
+
+#include "../color_lut.hpp"
+#include "../lut_cache.hpp"
+#include "../solution_cache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    struct error_stats {
+        double max = 0.0;
+        double mean = 0.0;
+    };
+
+    error_stats measure_error(const ser::color_lut& lut, const ser::exact_solution_cache& exact,
+            const std::vector<QRgb>& colors) {
+        const size_t inks = lut.palette().size();
+        std::vector<float> k(inks);
+        std::vector<float> ref(inks);
+        error_stats err;
+        for (QRgb c : colors) {
+            lut.look_up(QColor(c), k);
+            exact.look_up(c, ref);
+            for (size_t i = 0; i < inks; ++i) {
+                double e = std::abs(k[i] - ref[i]);
+                err.max = std::max(err.max, e);
+                err.mean += e;
+            }
+        }
+        err.mean /= colors.size() * inks;
+        return err;
+    }
+
+    // Best of three passes over the image, in ns per pixel
+    double time_rows(const ser::color_lut& lut, const std::vector<QRgb>& image, int width, int height) {
+        const size_t inks = lut.palette().size();
+        std::vector<float> planes(inks * width);
+        std::vector<float*> rows(inks);
+        for (size_t i = 0; i < inks; ++i) rows[i] = planes.data() + i * width;
+
+        double best = 1e30;
+        for (int run = 0; run < 3; ++run) {
+            auto start = clock_type::now();
+            for (int y = 0; y < height; ++y) {
+                lut.look_up_row(image.data() + static_cast<size_t>(y) * width, width, rows.data());
+            }
+            double ns = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+            best = std::min(best, ns / (static_cast<double>(width) * height));
+        }
+        return best;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    const int inks = (argc > 1) ? std::atoi(argv[1]) : 8;
+    const int samples = (argc > 2) ? std::atoi(argv[2]) : 20000;
+    const int width = (argc > 3) ? std::atoi(argv[3]) : 6000;
+    const int height = (argc > 4) ? std::atoi(argv[4]) : 2000;
+
+    // 1. Bake a random palette and solve the sample colors exactly,
+    // bypassing the on-disk caches
+    ser::set_lut_cache_directory("");
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::vector<QColor> palette;
+    for (int i = 0; i < inks; ++i) {
+        palette.emplace_back(channel(rng), channel(rng), channel(rng));
+    }
+    ser::color_lut lut(palette);
+
+    std::vector<QRgb> colors(samples);
+    for (QRgb& c : colors) c = qRgb(channel(rng), channel(rng), channel(rng));
+    ser::exact_solution_cache exact(palette);
+    exact.solve(colors);
+
+    // 2. A smooth gradient, where neighbouring pixels share cells, and
+    // random pixels, where they do not
+    std::vector<QRgb> smooth(static_cast<size_t>(width) * height);
+    std::vector<QRgb> noise(smooth.size());
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            size_t i = static_cast<size_t>(y) * width + x;
+            smooth[i] = qRgb(x * 255 / width, y * 255 / height, (x + y) * 255 / (width + height));
+            noise[i] = qRgb(channel(rng), channel(rng), channel(rng));
+        }
+    }
+
+    std::printf("%d inks, %d exact samples, %dx%d px\n", inks, samples, width, height);
+    std::printf("mode         max err  mean err  smooth img   random img\n");
+    for (auto mode : { ser::interpolation::trilinear, ser::interpolation::tetrahedral }) {
+        lut.set_interpolation(mode);
+        error_stats err = measure_error(lut, exact, colors);
+        double smooth_ns = time_rows(lut, smooth, width, height);
+        double noise_ns = time_rows(lut, noise, width, height);
+        std::printf("%-12s %.3f    %.5f   %5.1f ns/px  %5.1f ns/px\n",
+            mode == ser::interpolation::trilinear ? "trilinear" : "tetrahedral",
+            err.max, err.mean, smooth_ns, noise_ns);
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+// Benchmark: the flat float LUT against the nested vector-of-vectors
+// layout it replaced. Bakes a random palette, copies the lattice into the
+// old layout, then reports the memory of both and the latency of single
+// lookups through each.
+//
+// usage: bench_lut_storage [inks] [lookups]
+
+#include "../color_lut.hpp"
+#include "../lut_cache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+    using nested_lut = std::vector<std::vector<std::vector<std::vector<double>>>>;
+
+    // Per-allocation bookkeeping of a typical 64-bit malloc
+    constexpr size_t MALLOC_OVERHEAD = 16;
+
+    size_t nested_bytes(const nested_lut& lut) {
+        size_t bytes = sizeof(lut) + lut.capacity() * sizeof(lut[0]);
+        for (const auto& plane : lut) {
+            bytes += MALLOC_OVERHEAD + plane.capacity() * sizeof(plane[0]);
+            for (const auto& line : plane) {
+                bytes += MALLOC_OVERHEAD + line.capacity() * sizeof(line[0]);
+                for (const auto& node : line) {
+                    bytes += MALLOC_OVERHEAD + node.capacity() * sizeof(double);
+                }
+            }
+        }
+        return bytes;
+    }
+
+    // The trilinear lookup of the nested layout, as it was
+    ser::coefficients nested_look_up(const nested_lut& lut, const QColor& color) {
+        const int grid = static_cast<int>(lut.size());
+        float r_pos = color.red() * (grid - 1) / 255.0f;
+        float g_pos = color.green() * (grid - 1) / 255.0f;
+        float b_pos = color.blue() * (grid - 1) / 255.0f;
+        int r0 = std::clamp(static_cast<int>(r_pos), 0, grid - 2);
+        int g0 = std::clamp(static_cast<int>(g_pos), 0, grid - 2);
+        int b0 = std::clamp(static_cast<int>(b_pos), 0, grid - 2);
+        float tr = r_pos - r0;
+        float tg = g_pos - g0;
+        float tb = b_pos - b0;
+
+        const auto& c000 = lut[r0][g0][b0];
+        const auto& c100 = lut[r0 + 1][g0][b0];
+        const auto& c010 = lut[r0][g0 + 1][b0];
+        const auto& c110 = lut[r0 + 1][g0 + 1][b0];
+        const auto& c001 = lut[r0][g0][b0 + 1];
+        const auto& c101 = lut[r0 + 1][g0][b0 + 1];
+        const auto& c011 = lut[r0][g0 + 1][b0 + 1];
+        const auto& c111 = lut[r0 + 1][g0 + 1][b0 + 1];
+
+        ser::coefficients result(c000.size());
+        for (size_t i = 0; i < result.size(); ++i) {
+            float c00 = c000[i] * (1 - tr) + c100[i] * tr;
+            float c01 = c001[i] * (1 - tr) + c101[i] * tr;
+            float c10 = c010[i] * (1 - tr) + c110[i] * tr;
+            float c11 = c011[i] * (1 - tr) + c111[i] * tr;
+            float c0 = c00 * (1 - tg) + c10 * tg;
+            float c1 = c01 * (1 - tg) + c11 * tg;
+            result[i] = c0 * (1 - tb) + c1 * tb;
+        }
+        return result;
+    }
+
+    // Best of three runs of f over all colors, in ns per lookup
+    template <typename F>
+    double time_lookups(const std::vector<QColor>& colors, F&& f) {
+        double best = 1e30;
+        for (int run = 0; run < 3; ++run) {
+            auto start = clock_type::now();
+            for (const QColor& c : colors) f(c);
+            double ns = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+            best = std::min(best, ns / colors.size());
+        }
+        return best;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    const int inks = (argc > 1) ? std::atoi(argv[1]) : 12;
+    const int lookups = (argc > 2) ? std::atoi(argv[2]) : 2000000;
+
+    // 1. Bake a random palette, bypassing the on-disk cache
+    ser::set_lut_cache_directory("");
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::vector<QColor> palette;
+    for (int i = 0; i < inks; ++i) {
+        palette.emplace_back(channel(rng), channel(rng), channel(rng));
+    }
+    ser::color_lut lut(palette);
+
+    // 2. Copy the lattice into the old layout
+    const int grid = lut.grid_size();
+    nested_lut nested(grid, std::vector<std::vector<std::vector<double>>>(grid,
+        std::vector<std::vector<double>>(grid)));
+    for (int r = 0; r < grid; ++r) {
+        for (int g = 0; g < grid; ++g) {
+            for (int b = 0; b < grid; ++b) {
+                auto node = lut.node(r, g, b);
+                nested[r][g][b].assign(node.begin(), node.end());
+            }
+        }
+    }
+
+    std::vector<QColor> colors;
+    colors.reserve(lookups);
+    for (int i = 0; i < lookups; ++i) {
+        colors.emplace_back(channel(rng), channel(rng), channel(rng));
+    }
+
+    // 3. Time single lookups; the sink keeps the results alive
+    volatile double sink = 0.0;
+    std::vector<float> k(inks);
+    double nested_ns = time_lookups(colors, [&](const QColor& c) { sink = sink + nested_look_up(nested, c)[0]; });
+    double flat_ns = time_lookups(colors, [&](const QColor& c) { sink = sink + lut.look_up(c)[0]; });
+    double span_ns = time_lookups(colors, [&](const QColor& c) { lut.look_up(c, k); sink = sink + k[0]; });
+
+    std::printf("%d inks, %d^3 lattice, %d random lookups\n", inks, grid, lookups);
+    std::printf("memory:  nested %.2f MB   flat %.2f MB\n",
+        nested_bytes(nested) / 1048576.0, lut.memory_usage() / 1048576.0);
+    std::printf("look_up: nested %.0f ns   flat %.0f ns   flat into span %.0f ns\n",
+        nested_ns, flat_ns, span_ns);
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Benchmark: the batched Mixbox conversions at each instruction set level
+// the build and the CPU support, against the vendored one-color functions.
+// rgb_to_latent runs over all 16.7M RGB colors, latent_to_rgb over as many
+// random two-color mixes; both report the speedup and the largest
+// difference from the reference.
+//
+// usage: bench_mixbox
+
+#include "../mixbox_kernels.hpp"
+#include "../simd_support.hpp"
+#include "../third-party/mixbox.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    constexpr int COLORS = 1 << 24;
+    constexpr int ROW = 4096;
+
+    using rgb_to_latent_fn = int (*)(const QRgb*, int, float* const*);
+    using latent_to_rgb_fn = int (*)(const float* const*, int, QRgb*);
+
+    struct level {
+        const char* name;
+        rgb_to_latent_fn to_latent;
+        latent_to_rgb_fn to_rgb;
+    };
+
+    int reference_to_latent(const QRgb* pixels, int count, float* const* latent) {
+        for (int x = 0; x < count; ++x) {
+            mixbox_latent z;
+            mixbox_rgb_to_latent(qRed(pixels[x]), qGreen(pixels[x]), qBlue(pixels[x]), z);
+            for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) latent[d][x] = z[d];
+        }
+        return count;
+    }
+
+    int reference_to_rgb(const float* const* latent, int count, QRgb* pixels) {
+        for (int x = 0; x < count; ++x) {
+            mixbox_latent z;
+            for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) z[d] = latent[d][x];
+            unsigned char r, g, b;
+            mixbox_latent_to_rgb(z, &r, &g, &b);
+            pixels[x] = qRgb(r, g, b);
+        }
+        return count;
+    }
+
+    // Best of three runs of f over every row, in ms
+    template <typename F>
+    double time_rows(F&& f) {
+        double best = 1e30;
+        for (int run = 0; run < 3; ++run) {
+            auto start = clock_type::now();
+            for (int offset = 0; offset < COLORS; offset += ROW) f(offset);
+            best = std::min(best, std::chrono::duration<double, std::milli>(clock_type::now() - start).count());
+        }
+        return best;
+    }
+
+}
+
+int main() {
+    std::vector<level> levels = { { "reference", reference_to_latent, reference_to_rgb } };
+#if SERIGRAPH_BUILD_AVX2
+    if (ser::cpu_has_avx2()) {
+        levels.push_back({ "avx2", ser::kernels::mixbox_rgb_to_latent_avx2, ser::kernels::mixbox_latent_to_rgb_avx2 });
+    }
+#endif
+#if SERIGRAPH_BUILD_AVX512
+    if (ser::cpu_has_avx512()) {
+        levels.push_back({ "avx512", ser::kernels::mixbox_rgb_to_latent_avx512, ser::kernels::mixbox_latent_to_rgb_avx512 });
+    }
+#endif
+
+    // 1. Every RGB color, and random mixes of two in latent space
+    std::vector<QRgb> pixels(COLORS);
+    for (int i = 0; i < COLORS; ++i) pixels[i] = 0xFF000000u | static_cast<QRgb>(i);
+
+    std::vector<std::vector<float>> mixes(MIXBOX_LATENT_SIZE, std::vector<float>(COLORS));
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (int i = 0; i < COLORS; ++i) {
+        QRgb a = rng();
+        QRgb b = rng();
+        float w = unit(rng);
+        mixbox_latent za, zb;
+        mixbox_rgb_to_latent(qRed(a), qGreen(a), qBlue(a), za);
+        mixbox_rgb_to_latent(qRed(b), qGreen(b), qBlue(b), zb);
+        for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) mixes[d][i] = w * za[d] + (1 - w) * zb[d];
+    }
+
+    // 2. Run each level, keeping the reference's results to compare with
+    std::vector<std::vector<float>> latent(MIXBOX_LATENT_SIZE, std::vector<float>(COLORS));
+    std::vector<std::vector<float>> ref_latent;
+    std::vector<QRgb> rgb(COLORS);
+    std::vector<QRgb> ref_rgb;
+    double ref_to_latent_ms = 0.0;
+    double ref_to_rgb_ms = 0.0;
+
+    std::printf("level       rgb_to_latent                    latent_to_rgb\n");
+    for (const level& l : levels) {
+        double to_latent_ms = time_rows([&](int offset) {
+            float* rows[MIXBOX_LATENT_SIZE];
+            for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) rows[d] = latent[d].data() + offset;
+            l.to_latent(pixels.data() + offset, ROW, rows);
+            });
+        double to_rgb_ms = time_rows([&](int offset) {
+            const float* rows[MIXBOX_LATENT_SIZE];
+            for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) rows[d] = mixes[d].data() + offset;
+            l.to_rgb(rows, ROW, rgb.data() + offset);
+            });
+
+        if (ref_latent.empty()) {
+            ref_latent = latent;
+            ref_rgb = rgb;
+            ref_to_latent_ms = to_latent_ms;
+            ref_to_rgb_ms = to_rgb_ms;
+        }
+        double latent_err = 0.0;
+        for (int d = 0; d < MIXBOX_LATENT_SIZE; ++d) {
+            for (int i = 0; i < COLORS; ++i) {
+                latent_err = std::max(latent_err, static_cast<double>(std::abs(latent[d][i] - ref_latent[d][i])));
+            }
+        }
+        int rgb_err = 0;
+        for (int i = 0; i < COLORS; ++i) {
+            rgb_err = std::max({ rgb_err, std::abs(qRed(rgb[i]) - qRed(ref_rgb[i])),
+                std::abs(qGreen(rgb[i]) - qGreen(ref_rgb[i])), std::abs(qBlue(rgb[i]) - qBlue(ref_rgb[i])) });
+        }
+
+        std::printf("%-10s  %5.0f ms %5.1fx  err %.1e   %5.0f ms %5.1fx  err %d levels\n", l.name,
+            to_latent_ms, ref_to_latent_ms / to_latent_ms, latent_err,
+            to_rgb_ms, ref_to_rgb_ms / to_rgb_ms, rgb_err);
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+// Benchmark: the adaptive octree LUT against the uniform 33^3 lattice.
+// Bakes a random palette with both, reports the QP solves, memory and bake
+// time of each, and the largest and mean deviation from an exact solve at
+// random colors.
+//
+// usage: bench_octree_lut [inks] [tolerance] [max_depth] [colors]
+
+#include "../color_lut.hpp"
+#include "../lut_cache.hpp"
+#include "../octree_lut.hpp"
+#include "../qp_solver.hpp"
+#include "../third-party/mixbox.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    template <typename F>
+    double time_ms(F&& f) {
+        auto start = clock_type::now();
+        f();
+        return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+    }
+
+    struct error_stats {
+        double max = 0.0;
+        double mean = 0.0;
+    };
+
+    // Per color, the largest coefficient deviation from the exact solution
+    template <typename Lut>
+    error_stats measure(const Lut& lut, const std::vector<QColor>& colors, const std::vector<double>& exact, int n) {
+        error_stats e;
+        std::vector<float> k(n);
+        for (size_t j = 0; j < colors.size(); ++j) {
+            lut.look_up(colors[j], k);
+            double worst = 0.0;
+            for (int i = 0; i < n; ++i) {
+                worst = std::max(worst, std::abs(exact[j * n + i] - k[i]));
+            }
+            e.max = std::max(e.max, worst);
+            e.mean += worst;
+        }
+        e.mean /= colors.size();
+        return e;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    const int inks = (argc > 1) ? std::atoi(argv[1]) : 8;
+    const double tolerance = (argc > 2) ? std::atof(argv[2]) : 0.03;
+    const int max_depth = (argc > 3) ? std::atoi(argv[3]) : 2;
+    const int count = (argc > 4) ? std::atoi(argv[4]) : 20000;
+
+    // Both bakes have to run, so the on-disk cache is bypassed
+    ser::set_lut_cache_directory("");
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::vector<QColor> palette;
+    for (int i = 0; i < inks; ++i) {
+        palette.emplace_back(channel(rng), channel(rng), channel(rng));
+    }
+
+    // 1. Bake both
+    ser::color_lut uniform;
+    ser::octree_lut octree;
+    double uniform_ms = time_ms([&] { uniform = ser::color_lut(palette); });
+    double octree_ms = time_ms([&] { octree = ser::octree_lut(palette, tolerance, max_depth); });
+
+    // 2. Exact solutions at random colors
+    const ser::qp_solver solver(uniform.palette(), ser::color_lut::lambda());
+    std::vector<QColor> colors;
+    std::vector<double> exact(static_cast<size_t>(count) * inks);
+    std::vector<double> k(inks);
+    for (int j = 0; j < count; ++j) {
+        QColor c(channel(rng), channel(rng), channel(rng));
+        mixbox_latent latent_arr;
+        mixbox_rgb_to_latent(c.red(), c.green(), c.blue(), latent_arr);
+        ser::latent_space_color target;
+        std::copy(std::begin(latent_arr), std::end(latent_arr), target.begin());
+        solver.solve(target, k);
+        std::copy(k.begin(), k.end(), exact.begin() + static_cast<size_t>(j) * inks);
+        colors.push_back(c);
+    }
+
+    // 3. Report
+    const int grid = ser::color_lut::full_grid_size();
+    const int uniform_solves = grid * grid * grid;
+    error_stats u = measure(uniform, colors, exact, inks);
+    error_stats o = measure(octree, colors, exact, inks);
+    const ser::octree_stats& stats = octree.stats();
+    std::printf("uniform %d^3: %d solves, %zu bytes, %.0f ms   max error %.4f   mean %.5f\n",
+        grid, uniform_solves, static_cast<size_t>(uniform_solves) * inks * sizeof(float), uniform_ms, u.max, u.mean);
+    std::printf("octree tolerance %.3f depth %d: %d solves, %zu bytes, %.0f ms   max error %.4f   mean %.5f\n",
+        tolerance, max_depth, stats.solves, stats.memory_bytes, octree_ms, o.max, o.mean);
+    std::printf("  %d cells, %d leaves, %d vertices (%d hanging), max error at solved points %.4f\n",
+        stats.cells, stats.leaves, stats.vertices, stats.hanging, stats.max_error);
+    std::printf("  %.1f%% fewer solves\n", 100.0 * (uniform_solves - stats.solves) / uniform_solves);
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Benchmark: the active-set bake against the Clp barrier bake it replaced.
+// Bakes random palettes with both backends, reports the time of each, and
+// checks that the two agree at random lattice nodes. Exits with status 1
+// if any coefficient differs by more than 1e-6.
+//
+// usage: bench_qp_solver [inks] [palettes] [samples]
+
+#include "../color_lut.hpp"
+#include "../lut_cache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    // Largest coefficient difference the two backends may show
+    constexpr double TOLERANCE = 1e-6;
+
+    template <typename F>
+    double time_ms(F&& f) {
+        auto start = clock_type::now();
+        f();
+        return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+    }
+
+}
+
+int main(int argc, char** argv) {
+    const int inks = (argc > 1) ? std::atoi(argv[1]) : 8;
+    const int palettes = (argc > 2) ? std::atoi(argv[2]) : 3;
+    const int samples = (argc > 3) ? std::atoi(argv[3]) : 2000;
+
+    // Both bakes have to run, so the on-disk cache is bypassed
+    ser::set_lut_cache_directory("");
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> channel(0, 255);
+
+    double worst = 0.0;
+    double active_set_total = 0.0;
+    double clp_total = 0.0;
+    for (int p = 0; p < palettes; ++p) {
+        std::vector<QColor> palette;
+        for (int i = 0; i < inks; ++i) {
+            palette.emplace_back(channel(rng), channel(rng), channel(rng));
+        }
+
+        // 1. Bake with each backend
+        ser::color_lut active_set;
+        ser::color_lut clp;
+        double active_set_ms = time_ms([&] { active_set = ser::color_lut(palette, ser::qp_backend::active_set); });
+        double clp_ms = time_ms([&] { clp = ser::color_lut(palette, ser::qp_backend::clp); });
+        active_set_total += active_set_ms;
+        clp_total += clp_ms;
+
+        // 2. Compare random nodes
+        const int grid = active_set.grid_size();
+        std::uniform_int_distribution<int> coordinate(0, grid - 1);
+        double max_diff = 0.0;
+        for (int s = 0; s < samples; ++s) {
+            int r = coordinate(rng);
+            int g = coordinate(rng);
+            int b = coordinate(rng);
+            auto a = active_set.node(r, g, b);
+            auto c = clp.node(r, g, b);
+            for (int i = 0; i < inks; ++i) {
+                max_diff = std::max(max_diff, static_cast<double>(std::abs(a[i] - c[i])));
+            }
+        }
+        worst = std::max(worst, max_diff);
+
+        const ser::bake_stats& stats = active_set.stats();
+        std::printf("palette %d: active set %.0f ms (%.2f iterations/node, %d factorizations)   "
+            "clp %.0f ms   speedup %.1fx   max diff %.2e\n",
+            p, active_set_ms, stats.average_iterations(), stats.factorizations,
+            clp_ms, clp_ms / active_set_ms, max_diff);
+    }
+
+    std::printf("%d inks, %d palettes, %d nodes each: active set %.0f ms   clp %.0f ms   max diff %.2e\n",
+        inks, palettes, samples, active_set_total, clp_total, worst);
+    if (worst > TOLERANCE) {
+        std::printf("FAILED: the backends differ by more than %.0e\n", TOLERANCE);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,42 @@
+// Build-time helper: inflates the Mixbox pigment table once and writes it
+// out as a C++ source file holding a read-only array, so that the
+// application starts without running the decompressor.
+//
+// usage: generate_mixbox_lut <output.cpp>
+
+#include "../third-party/mixbox.h"
+
+#include <cstdio>
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <output.cpp>\n", argv[0]);
+        return 1;
+    }
+
+    FILE* out = std::fopen(argv[1], "w");
+    if (!out) {
+        std::fprintf(stderr, "cannot write %s\n", argv[1]);
+        return 1;
+    }
+
+    // 1. Inflate through the vendored code path
+    const unsigned char* lut = mixbox_lut_data();
+
+    // 2. Emit the bytes, 24 to a line
+    std::fprintf(out, "// Generated by generate_mixbox_lut; do not edit.\n\n");
+    std::fprintf(out, "extern \"C\" const unsigned char mixbox_precomputed_lut[%d] = {\n", MIXBOX_LUT_SIZE);
+    for (int i = 0; i < MIXBOX_LUT_SIZE; ++i) {
+        std::fprintf(out, (i % 24 == 0) ? "    %d," : " %d,", lut[i]);
+        if (i % 24 == 23 || i == MIXBOX_LUT_SIZE - 1) {
+            std::fputc('\n', out);
+        }
+    }
+    std::fprintf(out, "};\n");
+
+    if (std::fclose(out) != 0) {
+        std::fprintf(stderr, "cannot write %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}